@@ -2,6 +2,7 @@
 #include "JoinUtils.hpp"
 #include "absl/container/flat_hash_map.h"
 
+#include <algorithm>
 #include <unordered_map>
 #include <vector>
 #include <iostream>
@@ -62,6 +63,84 @@ std::vector<ResultRelation> performJoin(const std::vector<CastRelation>& castRel
     return resultTuples;
 }
 
+std::vector<ResultRelation> performJoin(const HeapRelation<HeapCastRelation>& castRelation,
+                                        const HeapRelation<HeapTitleRelation>& titleRelation,
+                                        int numThreads) {
+
+    // Die Tupel mit String-Heap sind kleiner, die Hashmap kopiert entsprechend weniger
+    absl::flat_hash_map<int, HeapTitleRelation> titleMap;
+    titleMap.reserve(titleRelation.size());
+    for (const auto& title : titleRelation.tuples) {
+        titleMap.emplace(title.titleId, title);
+    }
+
+    std::vector<std::vector<ResultRelation>> threadLocalResults(numThreads);
+    omp_set_num_threads(numThreads);
+
+#pragma omp parallel
+    {
+        std::vector<ResultRelation>& localResult = threadLocalResults[omp_get_thread_num()];
+        localResult.reserve((castRelation.size() / numThreads) * 1.25);
+
+#pragma omp for schedule(static, 508) nowait
+        for (const auto& cast : castRelation.tuples) {
+            auto it = titleMap.find(cast.movieId);
+            if (it != titleMap.end()) {
+                localResult.push_back(createResultTuple(cast, castRelation.strings, it->second, titleRelation.strings));
+            }
+        }
+    }
+
+    std::vector<ResultRelation> resultTuples;
+    resultTuples.reserve(castRelation.size());
+    for (auto& local : threadLocalResults) {
+        resultTuples.insert(resultTuples.end(),
+                            std::make_move_iterator(local.begin()),
+                            std::make_move_iterator(local.end()));
+    }
+
+    return resultTuples;
+}
+
+std::vector<ResultRelation> performJoin(const CastTable& castTable, const TitleTable& titleTable, int numThreads) {
+
+    // Die Hashmap kennt nur Schlüssel und Zeilennummer, die übrigen Spalten werden erst für Treffer gelesen
+    absl::flat_hash_map<int, uint32_t> titleRows;
+    titleRows.reserve(titleTable.size());
+    const auto& titleIds = titleTable.keys();
+    for (size_t row = 0; row < titleIds.size(); ++row) {
+        titleRows.emplace(titleIds[row], static_cast<uint32_t>(row));
+    }
+
+    std::vector<std::vector<ResultRelation>> threadLocalResults(numThreads);
+    omp_set_num_threads(numThreads);
+    const auto& movieIds = castTable.keys();
+
+#pragma omp parallel
+    {
+        std::vector<ResultRelation>& localResult = threadLocalResults[omp_get_thread_num()];
+        localResult.reserve((castTable.size() / numThreads) * 1.25);
+
+#pragma omp for schedule(static, 512) nowait
+        for (size_t row = 0; row < movieIds.size(); ++row) {
+            auto it = titleRows.find(movieIds[row]);
+            if (it != titleRows.end()) {
+                localResult.push_back(createResultTuple(castTable, row, titleTable, it->second));
+            }
+        }
+    }
+
+    std::vector<ResultRelation> resultTuples;
+    resultTuples.reserve(castTable.size());
+    for (auto& local : threadLocalResults) {
+        resultTuples.insert(resultTuples.end(),
+                            std::make_move_iterator(local.begin()),
+                            std::make_move_iterator(local.end()));
+    }
+
+    return resultTuples;
+}
+
 
 TEST(ParallelizationTest, TestJoiningTuples) {
     std::cout << "Test reading data from a file.\n";
@@ -78,4 +157,42 @@ TEST(ParallelizationTest, TestJoiningTuples) {
     std::cout << "Timer: " << timer << std::endl;
     std::cout << "Result size: " << resultTuples.size() << std::endl;
     std::cout << "\n\n";
-}
\ No newline at end of file
+}
+
+TEST(ParallelizationTest, HeapRelationJoin) {
+    const auto leftRelation = loadCastRelation(DATA_DIRECTORY + std::string("cast_info_uniform.csv"), 1000000);
+    const auto rightRelation = loadTitleRelation(DATA_DIRECTORY + std::string("title_info_uniform.csv"), 1000000);
+    const auto heapCast = toHeapRelation(leftRelation);
+    const auto heapTitle = toHeapRelation(rightRelation);
+    reportMemorySaved("cast_info", leftRelation, heapCast);
+    reportMemorySaved("title_info", rightRelation, heapTitle);
+
+    auto expected = performJoin(leftRelation, rightRelation, 8);
+    Timer timer("Parallelized Join on heap relations");
+    timer.start();
+    auto resultTuples = performJoin(heapCast, heapTitle, 8);
+    timer.pause();
+
+    std::sort(expected.begin(), expected.end());
+    std::sort(resultTuples.begin(), resultTuples.end());
+    EXPECT_TRUE(resultTuples == expected);
+    std::cout << "Timer: " << timer << std::endl;
+}
+
+TEST(ParallelizationTest, ColumnTableJoin) {
+    const auto leftRelation = loadCastRelation(DATA_DIRECTORY + std::string("cast_info_uniform.csv"), 1000000);
+    const auto rightRelation = loadTitleRelation(DATA_DIRECTORY + std::string("title_info_uniform.csv"), 1000000);
+    const CastTable castTable = toColumnTable(leftRelation);
+    const TitleTable titleTable = toColumnTable(rightRelation);
+
+    auto expected = performJoin(leftRelation, rightRelation, 8);
+    Timer timer("Parallelized Join on column tables");
+    timer.start();
+    auto resultTuples = performJoin(castTable, titleTable, 8);
+    timer.pause();
+
+    std::sort(expected.begin(), expected.end());
+    std::sort(resultTuples.begin(), resultTuples.end());
+    EXPECT_TRUE(resultTuples == expected);
+    std::cout << "Timer: " << timer << std::endl;
+}
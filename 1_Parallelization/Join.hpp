@@ -18,4 +18,16 @@
 
 std::vector<ResultRelation> performJoin(const std::vector<CastRelation>& leftRelation, const std::vector<TitleRelation>& rightRelation, int numThreads);
 
+/**
+ * @brief joins relations whose strings live in a string heap; the result
+ * tuples are the same as for the fixed-width relations
+ */
+std::vector<ResultRelation> performJoin(const HeapRelation<HeapCastRelation>& leftRelation, const HeapRelation<HeapTitleRelation>& rightRelation, int numThreads);
+
+/**
+ * @brief joins column tables on their key columns, the payload columns are
+ * only read for the matching rows
+ */
+std::vector<ResultRelation> performJoin(const CastTable& leftRelation, const TitleTable& rightRelation, int numThreads);
+
 #endif // JOIN_HPP
\ No newline at end of file
@@ -5,64 +5,69 @@
 #include <iostream>
 #include <string>
 #include <chrono>
+#include <algorithm>
+#include <unordered_map>
 using namespace std;
 
 
-int splitTitle(const vector<TitleRelation>& titleRelation, int index_of_cutoff) {
+// The helpers work on fixed-width and on string heap tuples alike, they only look at the join keys
+template <typename Title>
+int splitTitle(const vector<Title>& titleRelation, int index_of_cutoff) {
     if (index_of_cutoff < 0 || index_of_cutoff >= static_cast<int>(titleRelation.size()))
         return 0;
 
     int current_id = titleRelation[index_of_cutoff].titleId;
     int current_index = index_of_cutoff;
 
-    if (current_index + 1 < static_cast<int>(titleRelation.size()) &&
-        titleRelation[current_index + 1].titleId != current_id) {
-        while (current_index > 0 && titleRelation[current_index - 1].titleId == current_id) {
-            current_index--;
-        }
+    // The slice ends in front of the first tuple with the id at the cutoff
+    while (current_index > 0 && titleRelation[current_index - 1].titleId == current_id) {
+        current_index--;
     }
 
     return current_index;
 }
 
-// Safely walks backward through titleRelation to find cutoff
-int backTitle(const vector<TitleRelation>& titleRelation, int movieId, int index_of_cutoff) {
+// Safely walks backward through titleRelation to the first tuple whose id is not below movieId
+template <typename Title>
+int backTitle(const vector<Title>& titleRelation, int movieId, int index_of_cutoff) {
     int current_index = index_of_cutoff;
-    while (current_index > 0 && titleRelation[current_index].titleId > movieId) {
+    while (current_index > 0 && titleRelation[current_index - 1].titleId >= movieId) {
         current_index--;
     }
     return current_index;
 }
 
 // Safely splits castRelation vector at cutoff index
-int splitCast(const vector<CastRelation>& castRelation, int index_of_cutoff) {
+template <typename Cast>
+int splitCast(const vector<Cast>& castRelation, int index_of_cutoff) {
     if (index_of_cutoff < 0 || index_of_cutoff >= static_cast<int>(castRelation.size()))
         return 0;
 
     int current_id = castRelation[index_of_cutoff].movieId;
     int current_index = index_of_cutoff;
 
-    if (current_index + 1 < static_cast<int>(castRelation.size()) &&
-        castRelation[current_index + 1].movieId != current_id) {
-        while (current_index > 0 && castRelation[current_index - 1].movieId == current_id) {
-            current_index--;
-        }
+    // The slice ends in front of the first tuple with the id at the cutoff
+    while (current_index > 0 && castRelation[current_index - 1].movieId == current_id) {
+        current_index--;
     }
 
     return current_index;
 }
 
-// Safely walks backward through castRelation to find cutoff
-int backCast(const vector<CastRelation>& castRelation, int titleId, int index_of_cutoff) {
+// Safely walks backward through castRelation to the first tuple whose id is not below titleId
+template <typename Cast>
+int backCast(const vector<Cast>& castRelation, int titleId, int index_of_cutoff) {
     int current_index = index_of_cutoff;
-    while (current_index > 0 && castRelation[current_index].movieId > titleId) {
+    while (current_index > 0 && castRelation[current_index - 1].movieId >= titleId) {
         current_index--;
     }
     return current_index;
 }
 
-// Determines how to slice castRelation and titleRelation at a cutoff point
-vector<int> splitRelations(const vector<CastRelation>& castRelation, const vector<TitleRelation>& titleRelation, int cast_index_of_cutoff, int title_index_of_cutoff) {
+// Determines how to slice castRelation and titleRelation at a cutoff point. Both relations are sorted by their
+// ids; the slices end in front of the smaller of the two ids at the cutoffs, so every id lies in one slice pair.
+template <typename Cast, typename Title>
+vector<int> splitRelations(const vector<Cast>& castRelation, const vector<Title>& titleRelation, int cast_index_of_cutoff, int title_index_of_cutoff) {
     if (castRelation.empty() || titleRelation.empty() ||
         cast_index_of_cutoff >= static_cast<int>(castRelation.size()) ||
         title_index_of_cutoff >= static_cast<int>(titleRelation.size())) {
@@ -73,18 +78,19 @@ vector<int> splitRelations(const vector<CastRelation>& castRelation, const vecto
     int cast_id = castRelation[cast_index_of_cutoff].movieId;
 
     if (title_id > cast_id) {
-        int title_index = splitTitle(titleRelation, title_index_of_cutoff);
-        int cast_index = backCast(castRelation, titleRelation[title_index].titleId, cast_index_of_cutoff);
-        return {static_cast<int>(title_index), static_cast<int>(cast_index)};
-    } else {
         int cast_index = splitCast(castRelation, cast_index_of_cutoff);
         int title_index = backTitle(titleRelation, castRelation[cast_index].movieId, title_index_of_cutoff);
         return {static_cast<int>(title_index), static_cast<int>(cast_index)};
+    } else {
+        int title_index = splitTitle(titleRelation, title_index_of_cutoff);
+        int cast_index = backCast(castRelation, titleRelation[title_index].titleId, cast_index_of_cutoff);
+        return {static_cast<int>(title_index), static_cast<int>(cast_index)};
     }
 }
 
-// Performs join on two slices of cast/title relation
-vector<ResultRelation> performJoinThread(const vector<CastRelation>& castRelation, const vector<TitleRelation>& titleRelation) {
+// Performs join on two slices of cast/title relation, makeResult(cast, title) creates the result tuple
+template <typename Cast, typename Title, typename MakeResult>
+vector<ResultRelation> performJoinThread(const vector<Cast>& castRelation, const vector<Title>& titleRelation, MakeResult&& makeResult) {
     vector<ResultRelation> resultTuples;
     int pointer_cast = 0;
     int pointer_title = 0;
@@ -99,7 +105,7 @@ vector<ResultRelation> performJoinThread(const vector<CastRelation>& castRelatio
             old_position = pointer_cast;
             while (pointer_cast < castRelation.size() &&
                    castRelation[pointer_cast].movieId == titleRelation[pointer_title].titleId) {
-                resultTuples.push_back(createResultTuple(castRelation[pointer_cast], titleRelation[pointer_title]));
+                resultTuples.push_back(makeResult(castRelation[pointer_cast], titleRelation[pointer_title]));
                 pointer_cast++;
             }
             pointer_cast = old_position;
@@ -110,17 +116,21 @@ vector<ResultRelation> performJoinThread(const vector<CastRelation>& castRelatio
     return resultTuples;
 }
 
-vector<ResultRelation> performJoin(const vector<CastRelation>& castRelation, const vector<TitleRelation>& titleRelation, int numThreads) {
+// Both relations must be sorted by their ids. The slices hold the same tuples whatever the tuple type, so every
+// variant of the join produces the same result in the same order.
+template <typename Cast, typename Title, typename MakeResult>
+vector<ResultRelation> sortMergeJoin(const vector<Cast>& castRelation, const vector<Title>& titleRelation, int numThreads, MakeResult makeResult) {
     int half_cache_size_with_padding = 256 * 1024;
 
     if (castRelation.empty()) {
         printf("Size is empty!");
         return {};
     }
-    int index_of_cutoff = half_cache_size_with_padding / static_cast<int>(sizeof(castRelation[0]));
+    // Sized for the fixed-width cast tuples
+    int index_of_cutoff = half_cache_size_with_padding / static_cast<int>(sizeof(CastRelation));
 
-    vector<vector<CastRelation>> castSlices;
-    vector<vector<TitleRelation>> titleSlices;
+    vector<vector<Cast>> castSlices;
+    vector<vector<Title>> titleSlices;
     vector<ResultRelation> resultRelation;
 
     int title_offset = 0;
@@ -132,14 +142,19 @@ vector<ResultRelation> performJoin(const vector<CastRelation>& castRelation, con
         int title_cutoff = splitIndices[0];
         int cast_cutoff  = splitIndices[1];
 
+        // A single id fills the whole slice, the rest is joined as one slice
+        if (title_cutoff == title_offset && cast_cutoff == cast_offset) {
+            break;
+        }
+
         auto cast_end = std::min(castRelation.size(), static_cast<size_t>(cast_cutoff));
         auto title_end = std::min(titleRelation.size(), static_cast<size_t>(title_cutoff));
 
         castSlices.emplace_back(castRelation.begin() + cast_offset, castRelation.begin() + cast_end);
         titleSlices.emplace_back(titleRelation.begin() + title_offset, titleRelation.begin() + title_end);
 
-        title_offset += title_cutoff;
-        cast_offset += cast_cutoff;
+        title_offset = title_cutoff;
+        cast_offset = cast_cutoff;
     }
 
     if (cast_offset < castRelation.size() && title_offset < titleRelation.size()) {
@@ -159,9 +174,9 @@ vector<ResultRelation> performJoin(const vector<CastRelation>& castRelation, con
         thread_results[i].reserve(estimatedResultCount);
     }
 
-#pragma omp parallel for schedule(dynamic) num_threads(numThreads) default(none) shared(castSlices, titleSlices, thread_results)
+#pragma omp parallel for schedule(dynamic) num_threads(numThreads) default(none) shared(castSlices, titleSlices, thread_results, makeResult)
     for (int i = 0; i < static_cast<int>(castSlices.size()); ++i) {
-        thread_results[i] = performJoinThread(castSlices[i], titleSlices[i]);
+        thread_results[i] = performJoinThread(castSlices[i], titleSlices[i], makeResult);
     }
 
     size_t totalSize = 0;
@@ -178,6 +193,48 @@ vector<ResultRelation> performJoin(const vector<CastRelation>& castRelation, con
     return resultRelation;
 }
 
+vector<ResultRelation> performJoin(const vector<CastRelation>& castRelation, const vector<TitleRelation>& titleRelation, int numThreads) {
+    return sortMergeJoin(castRelation, titleRelation, numThreads, [](const CastRelation& cast, const TitleRelation& title) {
+        return createResultTuple(cast, title);
+    });
+}
+
+// Die Slices kopieren nur die kleinen Tupel, alle Slices teilen sich die String-Heaps der Eingaben
+vector<ResultRelation> performJoin(const HeapRelation<HeapCastRelation>& castRelation, const HeapRelation<HeapTitleRelation>& titleRelation, int numThreads) {
+    return sortMergeJoin(castRelation.tuples, titleRelation.tuples, numThreads,
+                         [&](const HeapCastRelation& cast, const HeapTitleRelation& title) {
+        return createResultTuple(cast, castRelation.strings, title, titleRelation.strings);
+    });
+}
+
+// Schlüssel und Zeile einer Spaltentabelle, mehr lesen die Hilfsfunktionen des Merge-Joins nicht
+struct CastKey {
+    int32_t movieId;
+    uint32_t row;
+};
+
+struct TitleKey {
+    int32_t titleId;
+    uint32_t row;
+};
+
+template <typename Key>
+static vector<Key> keysOf(const AlignedColumn<int32_t>& column) {
+    vector<Key> keys(column.size());
+    for (size_t row = 0; row < column.size(); ++row) {
+        keys[row] = {column[row], static_cast<uint32_t>(row)};
+    }
+    return keys;
+}
+
+// Die Slices enthalten nur 8 Byte pro Tupel, die übrigen Spalten werden erst für Treffer gelesen
+vector<ResultRelation> performJoin(const CastTable& castTable, const TitleTable& titleTable, int numThreads) {
+    return sortMergeJoin(keysOf<CastKey>(castTable.keys()), keysOf<TitleKey>(titleTable.keys()), numThreads,
+                         [&](const CastKey& cast, const TitleKey& title) {
+        return createResultTuple(castTable, cast.row, titleTable, title.row);
+    });
+}
+
 //----------------------------------------------------------------------------------------------------------------------------
 CastRelation makeCast(int id, int pid, int mid, int prid, const std::string& note, int order, int rid) {
     CastRelation c{};
@@ -212,6 +269,46 @@ TitleRelation makeTitle(int tid, const std::string& title, const std::string& in
     return t;
 }
 
+// Joins the uniform data set, sorted by the join keys, with the merge join and with a hash join as reference.
+// The string heap and column table variants have to produce exactly the result of the fixed-width join.
+bool checkJoinResults() {
+    vector<CastRelation> castRelation = loadCastRelation(DATA_DIRECTORY + std::string("cast_info_uniform.csv"));
+    vector<TitleRelation> titleRelation = loadTitleRelation(DATA_DIRECTORY + std::string("title_info_uniform.csv"));
+    std::stable_sort(castRelation.begin(), castRelation.end(),
+                     [](const CastRelation& lhs, const CastRelation& rhs) { return lhs.movieId < rhs.movieId; });
+    std::stable_sort(titleRelation.begin(), titleRelation.end(),
+                     [](const TitleRelation& lhs, const TitleRelation& rhs) { return lhs.titleId < rhs.titleId; });
+
+    unordered_multimap<int, const TitleRelation*> titles;
+    for (const auto& title : titleRelation) {
+        titles.emplace(title.titleId, &title);
+    }
+    vector<ResultRelation> expected;
+    for (const auto& cast : castRelation) {
+        auto [first, last] = titles.equal_range(cast.movieId);
+        for (; first != last; ++first) {
+            expected.push_back(createResultTuple(cast, *first->second));
+        }
+    }
+
+    const vector<ResultRelation> fixedResult = performJoin(castRelation, titleRelation, 8);
+    vector<ResultRelation> sortedResult = fixedResult;
+    std::sort(expected.begin(), expected.end());
+    std::sort(sortedResult.begin(), sortedResult.end());
+    const bool fixedMatches = sortedResult == expected;
+    const bool heapMatches = performJoin(toHeapRelation(castRelation), toHeapRelation(titleRelation), 8) == fixedResult;
+    const bool tableMatches = performJoin(toColumnTable(castRelation), toColumnTable(titleRelation), 8) == fixedResult;
+
+    std::cout << "\n=== Join check ===" << std::endl;
+    std::cout << "Fixed-width join:  " << fixedResult.size() << " of " << expected.size() << " tuples, "
+              << (fixedMatches ? "matches" : "DIFFERS FROM") << " the hash join" << std::endl;
+    std::cout << "String heap join:  " << (heapMatches ? "matches" : "DIFFERS FROM") << " the fixed-width join"
+              << std::endl;
+    std::cout << "Column table join: " << (tableMatches ? "matches" : "DIFFERS FROM") << " the fixed-width join"
+              << std::endl;
+    return fixedMatches && heapMatches && tableMatches;
+}
+
 int main() {std::vector<CastRelation> castRelations = {
     makeCast(1, 101, 10, 1, "note1", 0, 1),
     makeCast(2, 102, 10, 2, "note2", 1, 2),
@@ -270,5 +367,5 @@ int main() {std::vector<CastRelation> castRelations = {
         std::cout << titleRelationToString(titleRelations[i]) << std::endl;
     }
 
-    return 0;
+    return checkJoinResults() ? 0 : 1;
 }
\ No newline at end of file
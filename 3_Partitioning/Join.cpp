@@ -15,13 +15,19 @@
 #include <gtest/gtest.h>
 #include <omp.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <fstream>
 #include <iostream>
 #include <list>
 #include <span>
+#include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
+#include "Join.hpp"
 #include "JoinUtils.hpp"
 #include "TimerUtil.hpp"
 
@@ -32,14 +38,110 @@ constexpr int RADIX_BITS = 10;
 constexpr int RADIX_SIZE = 1 << RADIX_BITS;  // 2^RADIX_BITS partitions
 constexpr int RADIX_MASK = RADIX_SIZE - 1;
 
-thread_local std::vector<ResultRelation> threadLocalResults;
+template <typename T>
+static size_t capacityBytes(const std::vector<T> &vec) {
+  return vec.capacity() * sizeof(T);
+}
+
+size_t JoinContext::retainedBytes() const {
+  size_t bytes = capacityBytes(boardersA) + capacityBytes(boardersB) + capacityBytes(histogramA) +
+                 capacityBytes(histogramB) + capacityBytes(threadHistograms) +
+                 capacityBytes(inPlaceCursors) + capacityBytes(partitionedRelA) + capacityBytes(partitionedRelB) +
+                 capacityBytes(heapPartitionedRelA) + capacityBytes(heapPartitionedRelB) +
+                 capacityBytes(titleKeys) + capacityBytes(castKeys) +
+                 capacityBytes(hashTables) + capacityBytes(threadResults) + capacityBytes(threadSizes) +
+                 capacityBytes(tasks) + capacityBytes(threadBusyMs) + capacityBytes(threadLongestTaskMs) +
+                 capacityBytes(results);
+  for (const auto &table : hashTables) {
+    bytes += capacityBytes(table.heads) + capacityBytes(table.next);
+  }
+  for (const auto &local : threadResults) {
+    bytes += capacityBytes(local);
+  }
+  return bytes;
+}
+
+void JoinContext::release() {
+  *this = JoinContext{};
+}
+
+JoinContextPool::Lease JoinContextPool::acquire() {
+  std::unique_ptr<JoinContext> context;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!idle.empty()) {
+      context = std::move(idle.back());
+      idle.pop_back();
+    }
+  }
+  if (!context) {
+    context = std::make_unique<JoinContext>();
+  }
+  return {*this, std::move(context)};
+}
+
+void JoinContextPool::setMaxRetainedBytes(const size_t bytes) {
+  std::lock_guard<std::mutex> lock(mutex);
+  maxRetainedBytes = bytes;
+}
+
+void JoinContextPool::trim() {
+  std::lock_guard<std::mutex> lock(mutex);
+  idle.clear();
+}
+
+JoinContextPool &JoinContextPool::global() {
+  static JoinContextPool pool;
+  return pool;
+}
+
+size_t JoinContextPool::idleContexts() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return idle.size();
+}
+
+size_t JoinContextPool::idleBytes() {
+  std::lock_guard<std::mutex> lock(mutex);
+  size_t bytes = 0;
+  for (const auto &context : idle) {
+    bytes += context->retainedBytes();
+  }
+  return bytes;
+}
+
+// Contexts beyond the idle limit are destroyed, a context whose buffers would push the idle contexts over the
+// byte limit goes back empty. The buffers are freed after the lock is released.
+void JoinContextPool::giveBack(std::unique_ptr<JoinContext> context) {
+  std::unique_lock<std::mutex> lock(mutex);
+  if (idle.size() >= maxIdleContexts) {
+    lock.unlock();
+    return;
+  }
+  size_t bytes = 0;
+  for (const auto &other : idle) {
+    bytes += other->retainedBytes();
+  }
+  if (bytes + context->retainedBytes() <= maxRetainedBytes) {
+    idle.emplace_back(std::move(context));
+    return;
+  }
+  lock.unlock();
+  context->release();
+  lock.lock();
+  if (idle.size() < maxIdleContexts) {
+    idle.emplace_back(std::move(context));
+  }
+}
 
-void radixPartitionMovie(const std::vector<CastRelation> &rel, std::vector<CastRelation> &resRel,
-                    std::vector<int32_t> &boarders) {
+// The partitioning and join steps only read the join keys, so they run on the fixed-width tuples
+// as well as on the string heap tuples.
+template <typename Cast>
+void radixPartitionMovie(const std::vector<Cast> &rel, std::vector<Cast> &resRel,
+                    std::vector<int32_t> &boarders, std::vector<int32_t> &tmpRadixLengths) {
   boarders.resize(RADIX_SIZE + 1);
   resRel.resize(rel.size());
 
-  std::vector<int32_t> tmpRadixLengths(RADIX_SIZE);
+  tmpRadixLengths.assign(RADIX_SIZE, 0);
   for (const auto &elm : rel) {
     ++tmpRadixLengths[elm.movieId & RADIX_MASK];
   }
@@ -60,12 +162,13 @@ void radixPartitionMovie(const std::vector<CastRelation> &rel, std::vector<CastR
   boarders[boarders.size() - 1] = rel.size();
 }
 
-void radixPartitionTitle(const std::vector<TitleRelation> &rel, std::vector<TitleRelation> &resRel,
-                    std::vector<int32_t> &boarders) {
+template <typename Title>
+void radixPartitionTitle(const std::vector<Title> &rel, std::vector<Title> &resRel,
+                    std::vector<int32_t> &boarders, std::vector<int32_t> &tmpRadixLengths) {
   boarders.resize(RADIX_SIZE + 1);
   resRel.resize(rel.size());
 
-  std::vector<int32_t> tmpRadixLengths(RADIX_SIZE);
+  tmpRadixLengths.assign(RADIX_SIZE, 0);
   for (const auto &elm : rel) {
     ++tmpRadixLengths[elm.titleId & RADIX_MASK];
   }
@@ -86,59 +189,505 @@ void radixPartitionTitle(const std::vector<TitleRelation> &rel, std::vector<Titl
   boarders[boarders.size() - 1] = rel.size();
 }
 
-std::vector<ResultRelation> performJoin(const std::vector<RelB> &relB,
-                                        const std::vector<RelA> &relA,
-                                        const int numThreads) {
-  omp_set_num_threads(numThreads);
+// Bucket-wise American flag permutation of the subranges one thread owns. Elements whose
+// bucket has no free slot left in this thread's subranges are parked at the tail of the
+// current subrange and resolved in a later round.
+template <typename Rel, typename KeyFn>
+static void permuteSubranges(std::vector<Rel> &rel, int32_t *cursors, int32_t *tails, KeyFn radixOf) {
+  for (int32_t b = 0; b < RADIX_SIZE; ++b) {
+    while (cursors[b] < tails[b]) {
+      const int32_t k = radixOf(rel[cursors[b]]);
+      if (k == b) {
+        ++cursors[b];
+      } else if (cursors[k] < tails[k]) {
+        std::swap(rel[cursors[b]], rel[cursors[k]]);
+        ++cursors[k];
+      } else {
+        --tails[b];
+        std::swap(rel[cursors[b]], rel[tails[b]]);
+      }
+    }
+  }
+}
 
-  std::vector<int32_t> boardersA{};
-  std::vector<int32_t> boardersB{};
-  std::vector<RelA> vecPartitionedRelA{};
-  std::vector<RelB> vecPartitionedRelB{};
+// Parallel in-place radix partitioning in the style of PARADIS: every round splits the
+// unresolved part of each partition evenly among the threads, permutes speculatively and
+// then compacts the correctly placed prefixes. A final single-threaded round places all
+// remaining tuples, since one thread always finds a free slot for every tuple.
+template <typename Rel, typename KeyFn>
+static void radixPartitionInPlace(std::vector<Rel> &rel, std::vector<int32_t> &boarders, JoinContext &context,
+                                  const int numThreads, KeyFn radixOf) {
+  boarders.assign(RADIX_SIZE + 1, 0);
+  auto &histograms = context.threadHistograms;
+  histograms.assign(static_cast<size_t>(numThreads) * RADIX_SIZE, 0);
 
-#pragma omp parallel sections
+#pragma omp parallel num_threads(numThreads)
   {
-#pragma omp section
-    radixPartitionTitle(relA, vecPartitionedRelA, boardersA);
-#pragma omp section
-    radixPartitionMovie(relB, vecPartitionedRelB, boardersB);
+    int32_t *histogram = histograms.data() + static_cast<size_t>(omp_get_thread_num()) * RADIX_SIZE;
+#pragma omp for schedule(static)
+    for (size_t i = 0; i < rel.size(); ++i) {
+      ++histogram[radixOf(rel[i])];
+    }
   }
 
-  std::span partitionedRelA(vecPartitionedRelA);
-  std::span partitionedRelB(vecPartitionedRelB);
-  std::vector<size_t> threadSizes(numThreads);
-  std::vector<ResultRelation> resultRelation;
+  for (int32_t b = 0; b < RADIX_SIZE; ++b) {
+    int32_t count = 0;
+    for (int t = 0; t < numThreads; ++t) {
+      count += histograms[static_cast<size_t>(t) * RADIX_SIZE + b];
+    }
+    boarders[b + 1] = boarders[b] + count;
+  }
+
+  // Per thread and partition: first slot of the subrange, fill cursor and tail of unresolved tuples.
+  auto &cursors = context.inPlaceCursors;
+  cursors.resize(static_cast<size_t>(numThreads + 1) * 3 * RADIX_SIZE);
+  int32_t *heads = cursors.data() + static_cast<size_t>(numThreads) * 3 * RADIX_SIZE;
+  std::copy(boarders.begin(), boarders.end() - 1, heads);
 
-#pragma omp parallel
+  auto unresolved = [&] {
+    size_t remaining = 0;
+    for (int32_t b = 0; b < RADIX_SIZE; ++b) {
+      remaining += boarders[b + 1] - heads[b];
+    }
+    return remaining;
+  };
+
+  auto runRound = [&](const int threads) {
+#pragma omp parallel num_threads(threads)
+    {
+      const int tid = omp_get_thread_num();
+      int32_t *starts = cursors.data() + static_cast<size_t>(tid) * 3 * RADIX_SIZE;
+      int32_t *fills = starts + RADIX_SIZE;
+      int32_t *tails = fills + RADIX_SIZE;
+      for (int32_t b = 0; b < RADIX_SIZE; ++b) {
+        const int64_t length = boarders[b + 1] - heads[b];
+        starts[b] = heads[b] + static_cast<int32_t>(length * tid / threads);
+        fills[b] = starts[b];
+        tails[b] = heads[b] + static_cast<int32_t>(length * (tid + 1) / threads);
+      }
+      permuteSubranges(rel, fills, tails, radixOf);
+
+#pragma omp barrier
+#pragma omp for schedule(dynamic, 16)
+      for (int32_t b = 0; b < RADIX_SIZE; ++b) {
+        int32_t write = heads[b];
+        for (int t = 0; t < threads; ++t) {
+          const int32_t *threadStarts = cursors.data() + static_cast<size_t>(t) * 3 * RADIX_SIZE;
+          for (int32_t j = threadStarts[b]; j < threadStarts[RADIX_SIZE + b]; ++j) {
+            std::swap(rel[write++], rel[j]);
+          }
+        }
+        heads[b] = write;
+      }
+    }
+  };
+
+  constexpr size_t SERIAL_THRESHOLD = 1 << 14;
+  size_t remaining = unresolved();
+  while (numThreads > 1 && remaining > SERIAL_THRESHOLD) {
+    runRound(numThreads);
+    const size_t left = unresolved();
+    if (left == remaining) {
+      break;
+    }
+    remaining = left;
+  }
+  if (remaining > 0) {
+    runRound(1);
+  }
+}
+
+// All keys of a partition share their low RADIX_BITS, so the bucket is taken from the bits above.
+static uint32_t partitionBucket(const int32_t key, const uint32_t mask) {
+  return (static_cast<uint32_t>(key) >> RADIX_BITS) & mask;
+}
+
+template <typename Title>
+static void buildPartitionTable(PartitionHashTable &table, std::span<const Title> partition) {
+  uint32_t bucketCount = 1;
+  while (bucketCount < partition.size()) {
+    bucketCount <<= 1;
+  }
+  table.mask = bucketCount - 1;
+  table.heads.assign(bucketCount, -1);
+  table.next.resize(partition.size());
+
+  // Insert back to front so that every chain lists its tuples in input order.
+  for (int32_t i = static_cast<int32_t>(partition.size()) - 1; i >= 0; --i) {
+    const uint32_t bucket = partitionBucket(partition[i].titleId, table.mask);
+    table.next[i] = table.heads[bucket];
+    table.heads[bucket] = i;
+  }
+}
+
+// Building the hash table costs more per tuple than probing it.
+constexpr int64_t BUILD_COST_FACTOR = 2;
+
+// Orders the partition pairs by estimated cost, largest first, and drops pairs
+// with an empty side since they cannot produce any result.
+static void schedulePartitions(JoinContext &context) {
+  auto &tasks = context.tasks;
+  tasks.clear();
+  for (int32_t i = 0; i < RADIX_SIZE; ++i) {
+    const int64_t buildSize = context.boardersA[i + 1] - context.boardersA[i];
+    const int64_t probeSize = context.boardersB[i + 1] - context.boardersB[i];
+    if (buildSize == 0 || probeSize == 0) {
+      continue;
+    }
+    tasks.push_back({i, buildSize * BUILD_COST_FACTOR + probeSize});
+  }
+  std::sort(tasks.begin(), tasks.end(),
+            [](const PartitionTask &lhs, const PartitionTask &rhs) { return lhs.cost > rhs.cost; });
+  context.scheduleStats = {};
+  context.scheduleStats.scheduledPartitions = tasks.size();
+  context.scheduleStats.prunedPartitions = RADIX_SIZE - tasks.size();
+}
+
+static void summarizeSchedule(JoinContext &context, const int numThreads) {
+  auto &stats = context.scheduleStats;
+  for (int t = 0; t < numThreads; ++t) {
+    stats.totalWorkMs += context.threadBusyMs[t];
+    stats.makespanMs = std::max(stats.makespanMs, context.threadBusyMs[t]);
+    stats.longestTaskMs = std::max(stats.longestTaskMs, context.threadLongestTaskMs[t]);
+  }
+  stats.idealMakespanMs = std::max(stats.totalWorkMs / numThreads, stats.longestTaskMs);
+}
+
+// makeResult(cast, title) creates the result tuple of a matching pair.
+template <typename Cast, typename Title, typename MakeResult>
+static void joinPartitions(JoinContext &context, std::span<const Cast> partitionedRelB,
+                           std::span<const Title> partitionedRelA, const int numThreads,
+                           std::vector<ResultRelation> &resultRelation, const MakeResult &makeResult) {
+  const auto &boardersA = context.boardersA;
+  const auto &boardersB = context.boardersB;
+  auto &threadSizes = context.threadSizes;
+  threadSizes.assign(numThreads, 0);
+  context.threadBusyMs.assign(numThreads, 0);
+  context.threadLongestTaskMs.assign(numThreads, 0);
+  if (context.threadResults.size() < static_cast<size_t>(numThreads)) {
+    context.threadResults.resize(numThreads);
+  }
+  if (context.hashTables.size() < static_cast<size_t>(numThreads)) {
+    context.hashTables.resize(numThreads);
+  }
+  schedulePartitions(context);
+  const auto &tasks = context.tasks;
+
+#pragma omp parallel num_threads(numThreads)
   {
     const int tid = omp_get_thread_num();
-    threadLocalResults.clear();
+    std::vector<ResultRelation> &localResults = context.threadResults[tid];
+    PartitionHashTable &hashTable = context.hashTables[tid];
+    localResults.clear();
 
-#pragma omp for
-    for (int32_t i = 0; i < RADIX_SIZE; ++i) {
-      std::unordered_map<int32_t, std::vector<RelA>> hashTable;
+#pragma omp for schedule(dynamic, 1)
+    for (size_t t = 0; t < tasks.size(); ++t) {
+      const double taskStart = omp_get_wtime();
+      const int32_t i = tasks[t].partition;
       std::span subSpanA = partitionedRelA.subspan(
           boardersA[i], boardersA[i + 1] - boardersA[i]);
       std::span subSpanB = partitionedRelB.subspan(
           boardersB[i], boardersB[i + 1] - boardersB[i]);
-      if (subSpanA.empty() || subSpanB.empty()) {
-        continue;
+      buildPartitionTable(hashTable, subSpanA);
+
+      for (const auto &elm : subSpanB) {
+        for (int32_t idx = hashTable.heads[partitionBucket(elm.movieId, hashTable.mask)]; idx != -1;
+             idx = hashTable.next[idx]) {
+          if (subSpanA[idx].titleId == elm.movieId) {
+            localResults.emplace_back(makeResult(elm, subSpanA[idx]));
+          }
+        }
       }
-      for (const auto &elm : subSpanA) {
-        hashTable[elm.titleId].emplace_back(elm);
+
+      const double taskMs = (omp_get_wtime() - taskStart) * 1000.0;
+      context.threadBusyMs[tid] += taskMs;
+      context.threadLongestTaskMs[tid] = std::max(context.threadLongestTaskMs[tid], taskMs);
+    }
+
+    threadSizes[tid] = localResults.size();
+
+#pragma omp barrier
+#pragma omp single
+    {
+      for (size_t i = 1; i < threadSizes.size(); ++i) {
+        threadSizes[i] += threadSizes[i - 1];
       }
+      resultRelation.resize(threadSizes.empty() ? 0 : threadSizes.back());
+      summarizeSchedule(context, numThreads);
+    }
 
-      for (const auto &elm : subSpanB) {
-        auto found = hashTable.find(elm.movieId);
-        if (found == hashTable.end()) continue;
+    const size_t offset = (tid == 0) ? 0 : threadSizes[tid - 1];
+    std::move(localResults.begin(), localResults.end(),
+              resultRelation.begin() + offset);
+  }
+}
+
+static ResultRelation makeFixedResult(const RelB &cast, const RelA &title) {
+  return createResultTuple(cast, title);
+}
+
+// Partitions both inputs into the given buffers of the context and joins the partitions.
+template <typename Cast, typename Title, typename MakeResult>
+static void partitionAndJoin(JoinContext &context, const std::vector<Cast> &relB, const std::vector<Title> &relA,
+                             std::vector<Cast> &partitionedRelB, std::vector<Title> &partitionedRelA,
+                             const int numThreads, std::vector<ResultRelation> &resultRelation,
+                             const MakeResult &makeResult) {
+#pragma omp parallel sections num_threads(numThreads)
+  {
+#pragma omp section
+    radixPartitionTitle(relA, partitionedRelA, context.boardersA, context.histogramA);
+#pragma omp section
+    radixPartitionMovie(relB, partitionedRelB, context.boardersB, context.histogramB);
+  }
+  joinPartitions(context, std::span<const Cast>(partitionedRelB), std::span<const Title>(partitionedRelA), numThreads,
+                 resultRelation, makeResult);
+}
+
+// Consumes both inputs, partitions them in place and joins the partitions.
+template <typename Cast, typename Title, typename MakeResult>
+static void partitionInPlaceAndJoin(JoinContext &context, std::vector<Cast> &relB, std::vector<Title> &relA,
+                                    const int numThreads, std::vector<ResultRelation> &resultRelation,
+                                    const MakeResult &makeResult) {
+  radixPartitionInPlace(relA, context.boardersA, context, numThreads,
+                        [](const Title &elm) { return elm.titleId & RADIX_MASK; });
+  radixPartitionInPlace(relB, context.boardersB, context, numThreads,
+                        [](const Cast &elm) { return elm.movieId & RADIX_MASK; });
+  joinPartitions(context, std::span<const Cast>(relB), std::span<const Title>(relA), numThreads, resultRelation,
+                 makeResult);
+}
+
+template <typename Cast, typename Title, typename MakeResult>
+static std::vector<ResultRelation> partitionInPlaceAndJoin(std::vector<Cast> relB, std::vector<Title> relA,
+                                                           const int numThreads, const MakeResult &makeResult) {
+  const auto context = JoinContextPool::global().acquire();
+  std::vector<ResultRelation> resultRelation;
+  partitionInPlaceAndJoin(*context, relB, relA, numThreads, resultRelation, makeResult);
+  return resultRelation;
+}
+
+const std::vector<ResultRelation> &performJoin(JoinContext &context,
+                                               const std::vector<RelB> &relB,
+                                               const std::vector<RelA> &relA,
+                                               const int numThreads) {
+  partitionAndJoin(context, relB, relA, context.partitionedRelB, context.partitionedRelA, numThreads, context.results,
+                   makeFixedResult);
+  return context.results;
+}
+
+std::vector<ResultRelation> performJoin(const std::vector<RelB> &relB,
+                                        const std::vector<RelA> &relA,
+                                        const int numThreads) {
+  const auto context = JoinContextPool::global().acquire();
+  std::vector<ResultRelation> resultRelation;
+  partitionAndJoin(*context, relB, relA, context->partitionedRelB, context->partitionedRelA, numThreads,
+                   resultRelation, makeFixedResult);
+  return resultRelation;
+}
+
+std::vector<ResultRelation> performJoin(std::vector<RelB> &&relB,
+                                        std::vector<RelA> &&relA,
+                                        const int numThreads) {
+  return partitionInPlaceAndJoin(std::move(relB), std::move(relA), numThreads, makeFixedResult);
+}
+
+// The string heaps stay where they are, only the tuples with their offsets into the heaps are partitioned.
+const std::vector<ResultRelation> &performJoin(JoinContext &context,
+                                               const HeapRelation<HeapCastRelation> &relB,
+                                               const HeapRelation<HeapTitleRelation> &relA,
+                                               const int numThreads) {
+  partitionAndJoin(context, relB.tuples, relA.tuples, context.heapPartitionedRelB, context.heapPartitionedRelA,
+                   numThreads, context.results, [&](const HeapCastRelation &cast, const HeapTitleRelation &title) {
+                     return createResultTuple(cast, relB.strings, title, relA.strings);
+                   });
+  return context.results;
+}
+
+std::vector<ResultRelation> performJoin(const HeapRelation<HeapCastRelation> &relB,
+                                        const HeapRelation<HeapTitleRelation> &relA,
+                                        const int numThreads) {
+  const auto context = JoinContextPool::global().acquire();
+  std::vector<ResultRelation> resultRelation;
+  partitionAndJoin(*context, relB.tuples, relA.tuples, context->heapPartitionedRelB, context->heapPartitionedRelA,
+                   numThreads, resultRelation, [&](const HeapCastRelation &cast, const HeapTitleRelation &title) {
+                     return createResultTuple(cast, relB.strings, title, relA.strings);
+                   });
+  return resultRelation;
+}
+
+std::vector<ResultRelation> performJoin(HeapRelation<HeapCastRelation> &&relB,
+                                        HeapRelation<HeapTitleRelation> &&relA,
+                                        const int numThreads) {
+  const StringHeap castStrings = std::move(relB.strings);
+  const StringHeap titleStrings = std::move(relA.strings);
+  return partitionInPlaceAndJoin(std::move(relB.tuples), std::move(relA.tuples), numThreads,
+                                 [&](const HeapCastRelation &cast, const HeapTitleRelation &title) {
+                                   return createResultTuple(cast, castStrings, title, titleStrings);
+                                 });
+}
+
+template <typename Key>
+static void keysOf(const AlignedColumn<int32_t> &column, std::vector<Key> &keys, const int numThreads) {
+  keys.resize(column.size());
+#pragma omp parallel for schedule(static) num_threads(numThreads)
+  for (size_t row = 0; row < column.size(); ++row) {
+    keys[row] = {column[row], static_cast<uint32_t>(row)};
+  }
+}
+
+// Only the key columns are read while partitioning and joining; the pairs of key and row are
+// partitioned in place and the payload columns are gathered for the matches.
+static void joinTables(JoinContext &context, const CastTable &relB, const TitleTable &relA, const int numThreads,
+                       std::vector<ResultRelation> &resultRelation) {
+  keysOf(relA.keys(), context.titleKeys, numThreads);
+  keysOf(relB.keys(), context.castKeys, numThreads);
+  partitionInPlaceAndJoin(context, context.castKeys, context.titleKeys, numThreads, resultRelation,
+                          [&](const CastKey &cast, const TitleKey &title) {
+                            return createResultTuple(relB, cast.row, relA, title.row);
+                          });
+}
+
+const std::vector<ResultRelation> &performJoin(JoinContext &context, const CastTable &relB, const TitleTable &relA,
+                                               const int numThreads) {
+  joinTables(context, relB, relA, numThreads, context.results);
+  return context.results;
+}
+
+std::vector<ResultRelation> performJoin(const CastTable &relB, const TitleTable &relA, const int numThreads) {
+  const auto context = JoinContextPool::global().acquire();
+  std::vector<ResultRelation> resultRelation;
+  joinTables(*context, relB, relA, numThreads, resultRelation);
+  return resultRelation;
+}
+
+// Hash table over all titles of the pipelined join. Tuples are referenced by their index in the title vector
+// and pushed onto their chain with a compare-and-swap on the bucket head, so chunks can be inserted concurrently.
+struct SharedTitleTable {
+  // Indices are int32_t, so at most MAX_TUPLES tuples fit into the table.
+  static constexpr size_t MAX_TUPLES = INT32_MAX;
 
-        for (const auto &resElm : found->second) {
-          threadLocalResults.emplace_back(createResultTuple(elm, resElm));
+  explicit SharedTitleTable(const size_t tuples, const int numThreads) : next(tuples) {
+    size_t bucketCount = 1;
+    while (bucketCount < tuples) {
+      bucketCount <<= 1;
+    }
+    mask = static_cast<uint32_t>(bucketCount - 1);
+    heads = std::vector<std::atomic<int32_t>>(bucketCount);
+#pragma omp parallel for schedule(static) num_threads(numThreads)
+    for (size_t bucket = 0; bucket < bucketCount; ++bucket) {
+      heads[bucket].store(-1, std::memory_order_relaxed);
+    }
+  }
+
+  void insert(const int32_t key, const int32_t idx) {
+    std::atomic<int32_t> &head = heads[static_cast<uint32_t>(key) & mask];
+    int32_t first = head.load(std::memory_order_relaxed);
+    do {
+      next[idx] = first;
+    } while (!head.compare_exchange_weak(first, idx, std::memory_order_relaxed));
+  }
+
+  [[nodiscard]] int32_t chain(const int32_t key) const {
+    return heads[static_cast<uint32_t>(key) & mask].load(std::memory_order_relaxed);
+  }
+
+  std::vector<std::atomic<int32_t>> heads;
+  std::vector<int32_t> next;
+  uint32_t mask = 0;
+};
+
+// The records of the title chunks are counted up front, so every title chunk parses straight into its own
+// slots of one title vector. The threads take the chunks in file order, all title chunks before the cast
+// chunks, and a thread that runs out of title chunks parses cast chunks while the others still build. A cast
+// chunk is probed right after parsing once every title chunk is in the table, chunks parsed earlier are kept
+// and probed after the load. Counting the built chunks with release increments publishes the chains to the
+// thread that sees the last increment. The thread results live in a pooled context like those of performJoin.
+std::vector<ResultRelation> loadAndJoin(const std::string &castFile, const std::string &titleFile,
+                                        const int numThreads, PipelineStats &stats) {
+  const CsvChunks titleChunks(titleFile);
+  const CsvChunks castChunks(castFile);
+
+  std::vector<size_t> titleBegin(titleChunks.size() + 1, 0);
+#pragma omp parallel for schedule(static) num_threads(numThreads)
+  for (size_t chunk = 0; chunk < titleChunks.size(); ++chunk) {
+    titleBegin[chunk + 1] = titleChunks.records(chunk);
+  }
+  for (size_t chunk = 0; chunk < titleChunks.size(); ++chunk) {
+    titleBegin[chunk + 1] += titleBegin[chunk];
+  }
+  if (titleBegin.back() > SharedTitleTable::MAX_TUPLES) {
+    std::cerr << "Error: " << titleFile << " holds more than " << SharedTitleTable::MAX_TUPLES << " tuples"
+              << std::endl;
+    exit(-1);
+  }
+  std::vector<RelA> titles(titleBegin.back());
+  SharedTitleTable table(titles.size(), numThreads);
+
+  const size_t chunks = titleChunks.size() + castChunks.size();
+  std::atomic<size_t> nextChunk{0};
+  std::atomic<size_t> builtChunks{0};
+  std::atomic<size_t> parsedCastChunks{0};
+  std::atomic<size_t> probedWhileLoading{0};
+  std::atomic<size_t> keptChunks{0};
+  const auto context = JoinContextPool::global().acquire();
+  auto &threadSizes = context->threadSizes;
+  threadSizes.assign(numThreads, 0);
+  if (context->threadResults.size() < static_cast<size_t>(numThreads)) {
+    context->threadResults.resize(numThreads);
+  }
+  std::vector<ResultRelation> resultRelation;
+
+#pragma omp parallel num_threads(numThreads)
+  {
+    const int tid = omp_get_thread_num();
+    std::vector<ResultRelation> &localResults = context->threadResults[tid];
+    localResults.clear();
+    std::vector<RelB> casts;
+    std::vector<std::vector<RelB>> pending;
+    auto probe = [&](const std::vector<RelB> &castChunk) {
+      for (const auto &elm : castChunk) {
+        for (int32_t idx = table.chain(elm.movieId); idx != -1; idx = table.next[idx]) {
+          if (titles[idx].titleId == elm.movieId) {
+            localResults.emplace_back(createResultTuple(elm, titles[idx]));
+          }
+        }
+      }
+    };
+
+    for (size_t chunk = nextChunk.fetch_add(1, std::memory_order_relaxed); chunk < chunks;
+         chunk = nextChunk.fetch_add(1, std::memory_order_relaxed)) {
+      if (chunk < titleChunks.size()) {
+        std::vector<LoadError> errors;
+        const size_t first = titleBegin[chunk];
+        const size_t parsed = parseChunk(titleChunks.begin(chunk), titleChunks.end(chunk), titles.data() + first,
+                                         errors);
+        for (const LoadError &error : errors) {
+          std::cerr << error.message << std::endl;
+        }
+        for (size_t idx = first; idx < first + parsed; ++idx) {
+          table.insert(titles[idx].titleId, static_cast<int32_t>(idx));
+        }
+        builtChunks.fetch_add(1, std::memory_order_release);
+      } else {
+        castChunks.parse(chunk - titleChunks.size(), casts);
+        parsedCastChunks.fetch_add(1, std::memory_order_relaxed);
+        if (builtChunks.load(std::memory_order_acquire) == titleChunks.size()) {
+          if (parsedCastChunks.load(std::memory_order_relaxed) < castChunks.size()) {
+            probedWhileLoading.fetch_add(1, std::memory_order_relaxed);
+          }
+          probe(casts);
+        } else {
+          keptChunks.fetch_add(1, std::memory_order_relaxed);
+          pending.push_back(std::move(casts));
         }
       }
     }
 
-    threadSizes[tid] = threadLocalResults.size();
+    // The barrier orders every insertion before the probes of the kept chunks
+#pragma omp barrier
+    for (const auto &castChunk : pending) {
+      probe(castChunk);
+    }
+    threadSizes[tid] = localResults.size();
 
 #pragma omp barrier
 #pragma omp single
@@ -150,8 +699,262 @@ std::vector<ResultRelation> performJoin(const std::vector<RelB> &relB,
     }
 
     const size_t offset = (tid == 0) ? 0 : threadSizes[tid - 1];
-    std::move(threadLocalResults.begin(), threadLocalResults.end(),
-              resultRelation.begin() + offset);
+    std::move(localResults.begin(), localResults.end(), resultRelation.begin() + offset);
   }
+  stats = {titleChunks.size(), castChunks.size(), probedWhileLoading, keptChunks};
   return resultRelation;
-}
\ No newline at end of file
+}
+
+std::vector<ResultRelation> loadAndJoin(const std::string &castFile, const std::string &titleFile,
+                                        const int numThreads) {
+  PipelineStats stats;
+  return loadAndJoin(castFile, titleFile, numThreads, stats);
+}
+
+// Resets the peak resident set size (VmHWM) of this process, see proc(5).
+static void resetPeakRss() {
+  std::ofstream clearRefs("/proc/self/clear_refs");
+  clearRefs << "5";
+}
+
+static size_t readStatusKiB(const std::string &field) {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.rfind(field, 0) == 0) {
+      return std::stoul(line.substr(field.size() + 1));
+    }
+  }
+  return 0;
+}
+
+TEST(PartitioningTest, ConcurrentJoinsMatchSerialJoin) {
+  const auto leftRelation = loadCastRelation(DATA_DIRECTORY + std::string("cast_info_uniform.csv"), 1000000);
+  const auto rightRelation = loadTitleRelation(DATA_DIRECTORY + std::string("title_info_uniform.csv"), 1000000);
+
+  auto expected = performJoin(leftRelation, rightRelation, 8);
+  std::sort(expected.begin(), expected.end());
+
+  constexpr int numJoins = 4;
+  std::vector<std::vector<ResultRelation>> results(numJoins);
+  std::vector<std::thread> joins;
+  for (int i = 0; i < numJoins; ++i) {
+    joins.emplace_back([&, i] { results[i] = performJoin(leftRelation, rightRelation, 2); });
+  }
+  for (auto &join : joins) {
+    join.join();
+  }
+
+  for (auto &result : results) {
+    std::sort(result.begin(), result.end());
+    EXPECT_EQ(result.size(), expected.size());
+    EXPECT_TRUE(result == expected);
+  }
+
+  // After a burst of concurrent leases the pool keeps only as many contexts and bytes as it is allowed to
+  JoinContextPool pool(JoinContextPool::DEFAULT_MAX_RETAINED_BYTES, 2);
+  {
+    std::vector<JoinContextPool::Lease> leases;
+    for (int i = 0; i < numJoins; ++i) {
+      leases.push_back(pool.acquire());
+      performJoin(*leases.back(), leftRelation, rightRelation, 2);
+    }
+  }
+  EXPECT_EQ(pool.idleContexts(), 2u);
+  const size_t idleBytes = pool.idleBytes();
+  EXPECT_GT(idleBytes, 0u);
+  pool.setMaxRetainedBytes(idleBytes / 2);
+  {
+    std::vector<JoinContextPool::Lease> leases;
+    for (int i = 0; i < numJoins; ++i) {
+      leases.push_back(pool.acquire());
+      performJoin(*leases.back(), leftRelation, rightRelation, 2);
+    }
+  }
+  EXPECT_LE(pool.idleBytes(), idleBytes / 2);
+
+  JoinContext context;
+  performJoin(context, leftRelation, rightRelation, 8);
+  const size_t warmCapacity = context.retainedBytes();
+  Timer timer("Partitioned Join with reused context");
+  timer.start();
+  const auto &reused = performJoin(context, leftRelation, rightRelation, 8);
+  timer.pause();
+  EXPECT_EQ(reused.size(), expected.size());
+  EXPECT_EQ(context.retainedBytes(), warmCapacity);
+
+  std::cout << "Timer: " << timer << std::endl;
+  std::cout << "Result size: " << reused.size() << std::endl;
+  std::cout << "Context retains " << warmCapacity / (1024 * 1024) << " MiB" << std::endl;
+
+  const auto &stats = context.scheduleStats;
+  std::cout << "Scheduled partitions: " << stats.scheduledPartitions << ", pruned: " << stats.prunedPartitions
+            << std::endl;
+  std::cout << "Partition join makespan: " << stats.makespanMs << " ms, ideal: " << stats.idealMakespanMs
+            << " ms (longest task " << stats.longestTaskMs << " ms)" << std::endl;
+}
+
+TEST(PartitioningTest, InPlacePartitioningPeakMemory) {
+  const auto leftRelation = loadCastRelation(DATA_DIRECTORY + std::string("cast_info_uniform.csv"), 1000000);
+  const auto rightRelation = loadTitleRelation(DATA_DIRECTORY + std::string("title_info_uniform.csv"), 1000000);
+
+  JoinContextPool::global().trim();
+  resetPeakRss();
+  size_t baseline = readStatusKiB("VmRSS:");
+  Timer outOfPlaceTimer("Out-of-place partitioned Join");
+  outOfPlaceTimer.start();
+  auto expected = performJoin(leftRelation, rightRelation, 8);
+  outOfPlaceTimer.pause();
+  const size_t outOfPlacePeak = readStatusKiB("VmHWM:") - baseline;
+  std::sort(expected.begin(), expected.end());
+  JoinContextPool::global().trim();
+
+  auto ownedCast = leftRelation;
+  auto ownedTitle = rightRelation;
+  resetPeakRss();
+  baseline = readStatusKiB("VmRSS:");
+  Timer inPlaceTimer("In-place partitioned Join");
+  inPlaceTimer.start();
+  auto result = performJoin(std::move(ownedCast), std::move(ownedTitle), 8);
+  inPlaceTimer.pause();
+  const size_t inPlacePeak = readStatusKiB("VmHWM:") - baseline;
+  std::sort(result.begin(), result.end());
+
+  EXPECT_TRUE(result == expected);
+  std::cout << "Timer: " << outOfPlaceTimer << std::endl;
+  std::cout << "Timer: " << inPlaceTimer << std::endl;
+  std::cout << "Peak RSS above inputs, out-of-place: " << outOfPlacePeak / 1024 << " MiB" << std::endl;
+  std::cout << "Peak RSS above inputs, in-place:     " << inPlacePeak / 1024 << " MiB" << std::endl;
+}
+
+TEST(PartitioningTest, HeapRelationJoin) {
+  const auto leftRelation = loadCastRelation(DATA_DIRECTORY + std::string("cast_info_uniform.csv"), 1000000);
+  const auto rightRelation = loadTitleRelation(DATA_DIRECTORY + std::string("title_info_uniform.csv"), 1000000);
+  auto heapCast = toHeapRelation(leftRelation);
+  auto heapTitle = toHeapRelation(rightRelation);
+  reportMemorySaved("cast_info", leftRelation, heapCast);
+  reportMemorySaved("title_info", rightRelation, heapTitle);
+
+  auto expected = performJoin(leftRelation, rightRelation, 8);
+  std::sort(expected.begin(), expected.end());
+
+  Timer timer("Partitioned Join on heap relations");
+  timer.start();
+  auto result = performJoin(heapCast, heapTitle, 8);
+  timer.pause();
+  std::sort(result.begin(), result.end());
+  EXPECT_TRUE(result == expected);
+
+  JoinContext context;
+  auto reused = performJoin(context, heapCast, heapTitle, 8);
+  std::sort(reused.begin(), reused.end());
+  EXPECT_TRUE(reused == expected);
+  EXPECT_FALSE(context.heapPartitionedRelB.empty());
+  EXPECT_TRUE(context.partitionedRelB.empty());
+
+  auto inPlace = performJoin(std::move(heapCast), std::move(heapTitle), 8);
+  std::sort(inPlace.begin(), inPlace.end());
+  EXPECT_TRUE(inPlace == expected);
+  std::cout << "Timer: " << timer << std::endl;
+}
+
+// Sums the join keys, the minimum of repeated scans is reported
+template <typename Key>
+static double bestScanMs(const size_t tuples, Key &&keyOf, int64_t &checksum) {
+  double best = 0;
+  for (int repetition = 0; repetition < 10; ++repetition) {
+    const double start = omp_get_wtime();
+    int64_t sum = 0;
+    for (size_t i = 0; i < tuples; ++i) {
+      sum += keyOf(i);
+    }
+    const double ms = (omp_get_wtime() - start) * 1000.0;
+    best = repetition == 0 ? ms : std::min(best, ms);
+    checksum = sum;
+  }
+  return best;
+}
+
+TEST(PartitioningTest, ColumnTableJoinAndScanBandwidth) {
+  const auto leftRelation = loadCastRelation(DATA_DIRECTORY + std::string("cast_info_uniform.csv"), 1000000);
+  const auto rightRelation = loadTitleRelation(DATA_DIRECTORY + std::string("title_info_uniform.csv"), 1000000);
+  const CastTable castTable = toColumnTable(leftRelation);
+  const TitleTable titleTable = toColumnTable(rightRelation);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(castTable.keys().data()) % COLUMN_ALIGNMENT, 0u);
+
+  auto expected = performJoin(leftRelation, rightRelation, 8);
+  std::sort(expected.begin(), expected.end());
+
+  Timer timer("Partitioned Join on column tables");
+  timer.start();
+  auto result = performJoin(castTable, titleTable, 8);
+  timer.pause();
+  std::sort(result.begin(), result.end());
+  EXPECT_TRUE(result == expected);
+
+  JoinContext context;
+  auto reused = performJoin(context, castTable, titleTable, 8);
+  std::sort(reused.begin(), reused.end());
+  EXPECT_TRUE(reused == expected);
+  std::cout << "Timer: " << timer << std::endl;
+
+  // Bandwidth of a key scan: the struct layout reads every cache line of the tuples, the key column only the keys
+  int64_t structSum = 0;
+  int64_t columnSum = 0;
+  const double structMs = bestScanMs(leftRelation.size(), [&](size_t i) { return leftRelation[i].movieId; },
+                                     structSum);
+  const auto &movieIds = castTable.keys();
+  const double columnMs = bestScanMs(movieIds.size(), [&](size_t i) { return movieIds[i]; }, columnSum);
+  EXPECT_EQ(structSum, columnSum);
+
+  const double mebibyte = 1024.0 * 1024.0;
+  const double keyBytes = static_cast<double>(leftRelation.size() * sizeof(int32_t));
+  const double structBytes = static_cast<double>(leftRelation.size() * sizeof(CastRelation));
+  std::cout << "movieId scan, array of structs: " << structMs << " ms, " << keyBytes / mebibyte / (structMs / 1000.0)
+            << " MiB/s of keys, " << structBytes / mebibyte / (structMs / 1000.0) << " MiB/s read" << std::endl;
+  std::cout << "movieId scan, key column:       " << columnMs << " ms, " << keyBytes / mebibyte / (columnMs / 1000.0)
+            << " MiB/s of keys" << std::endl;
+}
+
+TEST(PartitioningTest, PipelinedLoadAndJoin) {
+  const std::string castFile = DATA_DIRECTORY + std::string("cast_info_uniform.csv");
+  const std::string titleFile = DATA_DIRECTORY + std::string("title_info_uniform.csv");
+
+  Timer loadTimer("Sequential load");
+  loadTimer.start();
+  const auto leftRelation = loadCastRelation(castFile);
+  const auto rightRelation = loadTitleRelation(titleFile);
+  loadTimer.pause();
+
+  Timer joinTimer("Partitioned Join after load");
+  joinTimer.start();
+  auto expected = performJoin(leftRelation, rightRelation, 8);
+  joinTimer.pause();
+
+  Timer pipelineTimer("Pipelined load and join");
+  pipelineTimer.start();
+  PipelineStats stats;
+  auto result = loadAndJoin(castFile, titleFile, 8, stats);
+  pipelineTimer.pause();
+
+  std::sort(expected.begin(), expected.end());
+  std::sort(result.begin(), result.end());
+  EXPECT_TRUE(result == expected);
+
+  std::cout << "Cast chunks with 8 threads: " << stats.castChunksProbedWhileLoading << " of " << stats.castChunks
+            << " probed while loading, " << stats.castChunksKept << " kept until the title table was complete"
+            << std::endl;
+
+  // Independent of the machine: a single thread builds the table from all title chunks first and then probes
+  // every cast chunk right after parsing it, all but the last one before the load is finished
+  auto serialResult = loadAndJoin(castFile, titleFile, 1, stats);
+  std::sort(serialResult.begin(), serialResult.end());
+  EXPECT_TRUE(serialResult == expected);
+  EXPECT_EQ(stats.castChunksKept, 0u);
+  EXPECT_EQ(stats.castChunksProbedWhileLoading, stats.castChunks - 1);
+
+  // The timings are noisy when the threads share few cores, they are reported but not compared
+  std::cout << "Load:      " << loadTimer << std::endl;
+  std::cout << "Join:      " << joinTimer << std::endl;
+  std::cout << "Pipelined: " << pipelineTimer << std::endl;
+}
@@ -15,7 +15,12 @@
 #define JOIN_HPP
 
 #include "JoinUtils.hpp"
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 struct HashFunctionForPartitionExercise {
     std::size_t operator()(const uint64_t& key) const {
@@ -26,6 +31,240 @@ struct HashFunctionForPartitionExercise {
 template <typename T>
 using HashMapForPartitionExercise = std::unordered_multimap<uint64_t, T, HashFunctionForPartitionExercise>;
 
+/**
+ * @brief Chained hash table over the tuples of one partition. Stores indices
+ * instead of tuples so that it can be rebuilt for every partition without
+ * allocating once its vectors reached their peak size.
+ */
+struct PartitionHashTable {
+    std::vector<int32_t> heads;
+    std::vector<int32_t> next;
+    uint32_t mask = 0;
+};
+
+/**
+ * @brief Join key and row of a column table. The column table join partitions
+ * these pairs instead of the tuples.
+ */
+struct CastKey {
+    int32_t movieId;
+    uint32_t row;
+};
+
+struct TitleKey {
+    int32_t titleId;
+    uint32_t row;
+};
+
+/**
+ * @brief One partition pair of the join phase with its estimated cost.
+ */
+struct PartitionTask {
+    int32_t partition;
+    int64_t cost;
+};
+
+/**
+ * @brief Outcome of scheduling the partition joins of the last join.
+ * The ideal makespan is the larger of the perfectly balanced work and the
+ * longest single task, no schedule can finish faster than that.
+ */
+struct PartitionScheduleStats {
+    size_t scheduledPartitions = 0;
+    size_t prunedPartitions = 0;
+    double totalWorkMs = 0;
+    double longestTaskMs = 0;
+    double makespanMs = 0;
+    double idealMakespanMs = 0;
+};
+
+/**
+ * @brief How the loading and probing of a pipelined join overlapped. A cast
+ * chunk counts as probed while loading if its probe started before every cast
+ * chunk was parsed; kept chunks were parsed before the title table was
+ * complete and are probed after the load.
+ */
+struct PipelineStats {
+    size_t titleChunks = 0;
+    size_t castChunks = 0;
+    size_t castChunksProbedWhileLoading = 0;
+    size_t castChunksKept = 0;
+};
+
+/**
+ * @brief Owns every buffer a single join invocation needs. Each concurrent
+ * performJoin call works on its own context, so no state is shared between
+ * joins running at the same time.
+ */
+class JoinContext {
+  public:
+    std::vector<int32_t> boardersA;
+    std::vector<int32_t> boardersB;
+    std::vector<int32_t> histogramA;
+    std::vector<int32_t> histogramB;
+    std::vector<int32_t> threadHistograms;
+    std::vector<int32_t> inPlaceCursors;
+    std::vector<TitleRelation> partitionedRelA;
+    std::vector<CastRelation> partitionedRelB;
+    std::vector<HeapTitleRelation> heapPartitionedRelA;
+    std::vector<HeapCastRelation> heapPartitionedRelB;
+    std::vector<TitleKey> titleKeys;
+    std::vector<CastKey> castKeys;
+    std::vector<PartitionHashTable> hashTables;
+    std::vector<std::vector<ResultRelation>> threadResults;
+    std::vector<size_t> threadSizes;
+    std::vector<PartitionTask> tasks;
+    std::vector<double> threadBusyMs;
+    std::vector<double> threadLongestTaskMs;
+    std::vector<ResultRelation> results;
+    PartitionScheduleStats scheduleStats;
+
+    /**
+     * @brief number of bytes currently held by the buffers of this context
+     */
+    [[nodiscard]] size_t retainedBytes() const;
+
+    /**
+     * @brief frees all buffers, the next join allocates them again
+     */
+    void release();
+};
+
+/**
+ * @brief Pool of idle join contexts. A lease hands out a context and returns it
+ * on destruction, so steady-state joins reuse the partitioning and hash table
+ * buffers of earlier joins instead of allocating new ones. The pool keeps at
+ * most maxIdleContexts contexts holding at most maxRetainedBytes together,
+ * contexts beyond that are freed when they come back.
+ */
+class JoinContextPool {
+  public:
+    static constexpr size_t DEFAULT_MAX_RETAINED_BYTES = size_t{1} << 30;
+    static constexpr size_t DEFAULT_MAX_IDLE_CONTEXTS = 8;
+
+    class Lease {
+      public:
+        Lease(JoinContextPool& pool, std::unique_ptr<JoinContext> context) : pool(&pool), context(std::move(context)) {}
+        Lease(Lease&& other) noexcept = default;
+        Lease& operator=(Lease&& other) noexcept = delete;
+        ~Lease() {
+            if (context) {
+                pool->giveBack(std::move(context));
+            }
+        }
+
+        JoinContext& operator*() const { return *context; }
+        JoinContext* operator->() const { return context.get(); }
+
+      private:
+        JoinContextPool* pool;
+        std::unique_ptr<JoinContext> context;
+    };
+
+    explicit JoinContextPool(size_t maxRetainedBytes = DEFAULT_MAX_RETAINED_BYTES, size_t maxIdleContexts = DEFAULT_MAX_IDLE_CONTEXTS)
+        : maxRetainedBytes(maxRetainedBytes), maxIdleContexts(maxIdleContexts) {}
+
+    /**
+     * @brief hands out an idle context or creates a new one if none is idle
+     */
+    Lease acquire();
+
+    /**
+     * @brief the idle contexts hold at most this many bytes together; a context
+     * that does not fit is released before it goes back into the pool
+     */
+    void setMaxRetainedBytes(size_t bytes);
+
+    /**
+     * @brief number of idle contexts currently kept
+     */
+    [[nodiscard]] size_t idleContexts();
+
+    /**
+     * @brief number of bytes held by the idle contexts
+     */
+    [[nodiscard]] size_t idleBytes();
+
+    /**
+     * @brief frees the buffers of all idle contexts
+     */
+    void trim();
+
+    /**
+     * @brief process-wide pool used by performJoin without an explicit context
+     */
+    static JoinContextPool& global();
+
+  private:
+    void giveBack(std::unique_ptr<JoinContext> context);
+
+    std::mutex mutex;
+    std::vector<std::unique_ptr<JoinContext>> idle;
+    size_t maxRetainedBytes;
+    size_t maxIdleContexts;
+};
+
+/**
+ * @brief joins on a context of the global pool. The returned result vector is
+ * allocated for every call; the overload taking a context reuses its result
+ * buffer instead.
+ */
 std::vector<ResultRelation> performJoin(const std::vector<CastRelation>& leftRelation, const std::vector<TitleRelation>& rightRelation, int numThreads);
 
+/**
+ * @brief joins into the result buffer of the given context. The returned
+ * reference stays valid until the context is used for the next join.
+ */
+const std::vector<ResultRelation>& performJoin(JoinContext& context, const std::vector<CastRelation>& leftRelation, const std::vector<TitleRelation>& rightRelation, int numThreads);
+
+/**
+ * @brief takes ownership of both relations and radix partitions them in place
+ * instead of into copies, so the peak memory stays at the size of the inputs.
+ * The inputs are consumed and released before the function returns.
+ */
+std::vector<ResultRelation> performJoin(std::vector<CastRelation>&& leftRelation, std::vector<TitleRelation>&& rightRelation, int numThreads);
+
+/**
+ * @brief joins relations whose strings live in a string heap. Only the small
+ * tuples are partitioned, the result tuples are the same as for the fixed-width
+ * relations.
+ */
+std::vector<ResultRelation> performJoin(const HeapRelation<HeapCastRelation>& leftRelation, const HeapRelation<HeapTitleRelation>& rightRelation, int numThreads);
+
+/**
+ * @brief string heap variant of the join into the result buffer of the given context
+ */
+const std::vector<ResultRelation>& performJoin(JoinContext& context, const HeapRelation<HeapCastRelation>& leftRelation, const HeapRelation<HeapTitleRelation>& rightRelation, int numThreads);
+
+/**
+ * @brief string heap variant of the in-place join; the tuples are partitioned
+ * in place and both relations are released before the function returns
+ */
+std::vector<ResultRelation> performJoin(HeapRelation<HeapCastRelation>&& leftRelation, HeapRelation<HeapTitleRelation>&& rightRelation, int numThreads);
+
+/**
+ * @brief joins column tables on their key columns, the payload columns are
+ * only read for the matching rows
+ */
+std::vector<ResultRelation> performJoin(const CastTable& leftRelation, const TitleTable& rightRelation, int numThreads);
+
+/**
+ * @brief column table variant of the join into the result buffer of the given context
+ */
+const std::vector<ResultRelation>& performJoin(JoinContext& context, const CastTable& leftRelation, const TitleTable& rightRelation, int numThreads);
+
+/**
+ * @brief loads both CSV files and joins them while they are read. Title chunks
+ * are inserted into a shared hash table as soon as they are parsed and cast
+ * chunks are probed as soon as they are parsed and the table is complete, so
+ * loading and joining overlap instead of running one after the other. The
+ * whole files are read, snapshots are not used.
+ */
+std::vector<ResultRelation> loadAndJoin(const std::string& castFile, const std::string& titleFile, int numThreads);
+
+/**
+ * @brief pipelined load and join that reports how loading and probing overlapped
+ */
+std::vector<ResultRelation> loadAndJoin(const std::string& castFile, const std::string& titleFile, int numThreads, PipelineStats& stats);
+
 #endif // JOIN_HPP
\ No newline at end of file
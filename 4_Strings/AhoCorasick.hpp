@@ -0,0 +1,185 @@
+/*
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#ifndef AHOCORASICK_HPP
+#define AHOCORASICK_HPP
+
+#include "JoinUtils.hpp"
+#include "StringKeys.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Aho-Corasick automaton over the folded notes. The goto and failure
+ * functions are resolved into one flat transition table with TOTAL_CHILDREN
+ * entries per state, so scanning a title is a single table lookup per symbol.
+ * States that end notes are linked to the next shorter note ending at the
+ * same position, and the cast tuples of every distinct note are one
+ * contiguous run.
+ */
+class AhoCorasick {
+public:
+    /**
+     * @brief per-thread marks of the notes already reported for the current
+     * title, so a note that occurs several times is reported once
+     */
+    struct SeenKeys {
+        std::vector<uint32_t> stamps;
+        uint32_t stamp = 0;
+    };
+
+    void build(const std::vector<CastRelation>& castRelation, const KeyColumn& noteKeys) {
+        transitions.assign(TOTAL_CHILDREN, NONE);
+        std::vector<uint32_t> terminal(castRelation.size());
+        for (size_t i = 0; i < castRelation.size(); ++i) {
+            uint32_t state = ROOT;
+            for (const char c : noteKeys[i]) {
+                const size_t edge = state * TOTAL_CHILDREN + static_cast<uint8_t>(c);
+                if (transitions[edge] == NONE) {
+                    transitions[edge] = stateCount();
+                    transitions.resize(transitions.size() + TOTAL_CHILDREN, NONE);
+                }
+                state = transitions[edge];
+            }
+            terminal[i] = state;
+        }
+
+        // Every state that ends a note gets a dense key, the casts of a key are stored contiguously.
+        keyOfState.assign(stateCount(), NONE);
+        std::vector<uint32_t> keyCounts;
+        for (const uint32_t state : terminal) {
+            if (keyOfState[state] == NONE) {
+                keyOfState[state] = static_cast<uint32_t>(keyCounts.size());
+                keyCounts.push_back(0);
+            }
+            ++keyCounts[keyOfState[state]];
+        }
+        castBegin.assign(keyCounts.size() + 1, 0);
+        for (size_t key = 0; key < keyCounts.size(); ++key) {
+            castBegin[key + 1] = castBegin[key] + keyCounts[key];
+        }
+        casts.resize(castRelation.size());
+        std::vector<uint32_t> cursor(castBegin.begin(), castBegin.end() - 1);
+        for (size_t i = 0; i < castRelation.size(); ++i) {
+            casts[cursor[keyOfState[terminal[i]]]++] = &castRelation[i];
+        }
+
+        // Breadth-first over the trie: missing transitions are taken from the failure state,
+        // whose row is complete because it is shallower.
+        std::vector<uint32_t> failure(stateCount(), ROOT);
+        outputLink.assign(stateCount(), NONE);
+        std::vector<uint32_t> queue;
+        queue.reserve(stateCount());
+        for (uint32_t symbol = 0; symbol < TOTAL_CHILDREN; ++symbol) {
+            uint32_t& next = transitions[symbol];
+            if (next == NONE) {
+                next = ROOT;
+            } else {
+                outputLink[next] = keyOfState[ROOT] != NONE ? ROOT : NONE;
+                queue.push_back(next);
+            }
+        }
+        for (size_t head = 0; head < queue.size(); ++head) {
+            const uint32_t state = queue[head];
+            const uint32_t* failureRow = transitions.data() + failure[state] * TOTAL_CHILDREN;
+            uint32_t* row = transitions.data() + state * TOTAL_CHILDREN;
+            for (uint32_t symbol = 0; symbol < TOTAL_CHILDREN; ++symbol) {
+                if (row[symbol] == NONE) {
+                    row[symbol] = failureRow[symbol];
+                    continue;
+                }
+                const uint32_t child = row[symbol];
+                const uint32_t fallback = failureRow[symbol];
+                failure[child] = fallback;
+                outputLink[child] = keyOfState[fallback] != NONE ? fallback : outputLink[fallback];
+                queue.push_back(child);
+            }
+        }
+        transitions.shrink_to_fit();
+    }
+
+    [[nodiscard]] SeenKeys newSeenKeys() const { return {std::vector<uint32_t>(distinctKeys(), 0), 0}; }
+
+    /**
+     * @brief calls visit(first, last) once for the cast tuples of every note
+     * that occurs anywhere in key
+     */
+    template <typename Visitor>
+    void visitContainedNotes(std::string_view key, SeenKeys& seen, Visitor&& visit) const {
+        if (++seen.stamp == 0) {
+            std::fill(seen.stamps.begin(), seen.stamps.end(), 0);
+            seen.stamp = 1;
+        }
+        uint32_t state = ROOT;
+        visitOutputs(state, seen, visit);
+        for (const char c : key) {
+            state = transitions[state * TOTAL_CHILDREN + static_cast<uint8_t>(c)];
+            visitOutputs(state, seen, visit);
+        }
+    }
+
+    /**
+     * @brief calls visit(first, last) for the cast tuples of every note that is
+     * a suffix of key
+     */
+    template <typename Visitor>
+    void visitSuffixNotes(std::string_view key, Visitor&& visit) const {
+        uint32_t state = ROOT;
+        for (const char c : key) {
+            state = transitions[state * TOTAL_CHILDREN + static_cast<uint8_t>(c)];
+        }
+        for (uint32_t s = keyOfState[state] != NONE ? state : outputLink[state]; s != NONE; s = outputLink[s]) {
+            const uint32_t noteKey = keyOfState[s];
+            visit(casts.data() + castBegin[noteKey], casts.data() + castBegin[noteKey + 1]);
+        }
+    }
+
+    [[nodiscard]] uint32_t stateCount() const { return static_cast<uint32_t>(transitions.size() / TOTAL_CHILDREN); }
+
+    [[nodiscard]] size_t distinctKeys() const { return castBegin.empty() ? 0 : castBegin.size() - 1; }
+
+    /**
+     * @brief bytes reserved by the transition table, the output links and the match lists
+     */
+    [[nodiscard]] size_t memoryBytes() const {
+        return (transitions.capacity() + keyOfState.capacity() + outputLink.capacity() + castBegin.capacity()) *
+                   sizeof(uint32_t) +
+               casts.capacity() * sizeof(const CastRelation*);
+    }
+
+private:
+    static constexpr uint32_t ROOT = 0;
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    std::vector<uint32_t> transitions; // TOTAL_CHILDREN entries per state
+    std::vector<uint32_t> keyOfState;  // note ending in the state, or NONE
+    std::vector<uint32_t> outputLink;  // longest proper suffix state that ends a note
+    std::vector<uint32_t> castBegin;
+    std::vector<const CastRelation*> casts;
+
+    // If a note was already reported for this title, so were all shorter notes on its output chain.
+    template <typename Visitor>
+    void visitOutputs(const uint32_t state, SeenKeys& seen, Visitor& visit) const {
+        for (uint32_t s = keyOfState[state] != NONE ? state : outputLink[state]; s != NONE; s = outputLink[s]) {
+            const uint32_t noteKey = keyOfState[s];
+            if (seen.stamps[noteKey] == seen.stamp) return;
+            seen.stamps[noteKey] = seen.stamp;
+            visit(casts.data() + castBegin[noteKey], casts.data() + castBegin[noteKey + 1]);
+        }
+    }
+};
+
+#endif // AHOCORASICK_HPP
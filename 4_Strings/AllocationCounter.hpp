@@ -0,0 +1,50 @@
+/*
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#ifndef ALLOCATIONCOUNTER_HPP
+#define ALLOCATIONCOUNTER_HPP
+
+#include <cstddef>
+
+/**
+ * @brief Counts the allocations made through the global operator new while
+ * counting is switched on. The counting operator new and delete are defined
+ * in AllocationCounter.cpp, which only the test executable links and which
+ * it announces with COUNT_ALLOCATIONS; the shared library keeps the default
+ * allocator and counts nothing.
+ */
+#if defined(COUNT_ALLOCATIONS)
+static constexpr bool ALLOCATIONS_COUNTED = true;
+
+void startCountingAllocations();
+
+std::size_t stopCountingAllocations();
+#else
+static constexpr bool ALLOCATIONS_COUNTED = false;
+
+inline void startCountingAllocations() {}
+
+inline std::size_t stopCountingAllocations() { return 0; }
+#endif
+
+/**
+ * @brief number of allocations made while function runs
+ */
+template <typename Function>
+std::size_t countAllocations(Function&& function) {
+    startCountingAllocations();
+    function();
+    return stopCountingAllocations();
+}
+
+#endif // ALLOCATIONCOUNTER_HPP
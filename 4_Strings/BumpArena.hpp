@@ -0,0 +1,83 @@
+/*
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#ifndef BUMPARENA_HPP
+#define BUMPARENA_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Bump allocator for objects that die together. Allocations advance a
+ * cursor through large blocks and are never freed on their own; destroying
+ * the arena releases all blocks at once without running destructors, so it
+ * only hands out trivially destructible objects. An arena is not thread-safe,
+ * concurrent builders use one arena each.
+ */
+class BumpArena {
+public:
+    static constexpr size_t BLOCK_SIZE = size_t{1} << 20;
+
+    BumpArena() = default;
+    BumpArena(BumpArena&&) noexcept = default;
+    BumpArena& operator=(BumpArena&&) noexcept = default;
+
+    template <typename T>
+    T* create() {
+        static_assert(std::is_trivially_destructible_v<T>, "the arena never runs destructors");
+        return new (allocate(sizeof(T), alignof(T))) T();
+    }
+
+    /**
+     * @brief uninitialized storage for count objects of type T
+     */
+    template <typename T>
+    T* allocateArray(const size_t count) {
+        static_assert(std::is_trivially_destructible_v<T>, "the arena never runs destructors");
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    /**
+     * @brief bytes of all blocks, used or not
+     */
+    [[nodiscard]] size_t reservedBytes() const { return reserved; }
+
+private:
+    std::vector<std::unique_ptr<std::byte[]>> blocks;
+    std::byte* cursor = nullptr;
+    std::byte* end = nullptr;
+    size_t reserved = 0;
+
+    void* allocate(const size_t size, const size_t alignment) {
+        auto address = reinterpret_cast<uintptr_t>(cursor);
+        address = (address + alignment - 1) & ~(uintptr_t{alignment} - 1);
+        if (cursor == nullptr || address + size > reinterpret_cast<uintptr_t>(end)) {
+            // Oversized requests get a block of their own, the rest of the current block is given up.
+            const size_t blockSize = std::max(BLOCK_SIZE, size + alignment);
+            blocks.emplace_back(new std::byte[blockSize]);
+            cursor = blocks.back().get();
+            end = cursor + blockSize;
+            reserved += blockSize;
+            address = (reinterpret_cast<uintptr_t>(cursor) + alignment - 1) & ~(uintptr_t{alignment} - 1);
+        }
+        cursor = reinterpret_cast<std::byte*>(address + size);
+        return reinterpret_cast<void*>(address);
+    }
+};
+
+#endif // BUMPARENA_HPP
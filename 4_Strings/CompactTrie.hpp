@@ -0,0 +1,282 @@
+/*
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#ifndef COMPACTTRIE_HPP
+#define COMPACTTRIE_HPP
+
+#include "JoinUtils.hpp"
+#include "StringKeys.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+ * @brief Prefix trie over the folded alphabet in the style of an adaptive radix
+ * tree. Nodes grow from 4 over 16 to a direct table of all 37 symbols (the
+ * alphabet is too small for the Node48/Node256 variants). Up to 4 children are
+ * stored inline in the 32 byte node header, the larger variants live in their
+ * own contiguous pools. Children are referenced by 32 bit indices
+ * and the matches of a node are stored in chunks of doubling size inside one
+ * shared array, so the trie needs no allocation per node and a lookup reads
+ * every match list in a few contiguous runs.
+ */
+template <typename Cast = CastRelation>
+class CompactTrie {
+public:
+    CompactTrie() { nodes.emplace_back(); }
+
+    void insert(std::string_view key, const Cast* cast) {
+        uint32_t node = ROOT;
+        for (const char c : key) {
+            const auto symbol = static_cast<uint8_t>(c);
+            uint32_t child = findChild(node, symbol);
+            if (child == NONE) {
+                child = static_cast<uint32_t>(nodes.size());
+                nodes.emplace_back();
+                addChild(node, symbol, child);
+            }
+            node = child;
+        }
+        appendMatch(nodes[node], cast);
+    }
+
+    void findPrefixMatches(std::string_view key, std::vector<const Cast*>& results) const {
+        visitPrefixMatches(key, [&](const Cast* const* first, const Cast* const* last) {
+            results.insert(results.end(), first, last);
+        });
+    }
+
+    /**
+     * @brief calls visit(first, last) for every contiguous run of cast tuples
+     * whose note is a prefix of key, without allocating; a visitor returning
+     * true stops the lookup
+     */
+    template <typename Visitor>
+    void visitPrefixMatches(std::string_view key, Visitor&& visit) const {
+        uint32_t node = ROOT;
+        for (const char c : key) {
+            if (visitMatches(nodes[node], visit)) return;
+            node = findChild(node, static_cast<uint8_t>(c));
+            if (node == NONE) return;
+        }
+        visitMatches(nodes[node], visit);
+    }
+
+    /**
+     * @brief moves the match chunks of every node into one contiguous run, so a
+     * lookup reads each match list with a single copy. Inserting afterwards
+     * is still possible.
+     */
+    void compactMatches() {
+        size_t listCount = 0;
+        size_t matchCount = 0;
+        for (const Node& node : nodes) {
+            if (node.firstChunk == NONE) continue;
+            ++listCount;
+            for (uint32_t chunk = node.firstChunk; chunk != NONE; chunk = chunks[chunk].next) {
+                matchCount += chunks[chunk].size;
+            }
+        }
+        std::vector<MatchChunk> compactChunks;
+        std::vector<const Cast*> compactMatches;
+        compactChunks.reserve(listCount);
+        compactMatches.reserve(matchCount);
+        for (Node& node : nodes) {
+            if (node.firstChunk == NONE) continue;
+            const auto begin = static_cast<uint32_t>(compactMatches.size());
+            for (uint32_t chunk = node.firstChunk; chunk != NONE; chunk = chunks[chunk].next) {
+                const auto first = matches.begin() + chunks[chunk].begin;
+                compactMatches.insert(compactMatches.end(), first, first + chunks[chunk].size);
+            }
+            const auto size = static_cast<uint32_t>(compactMatches.size()) - begin;
+            node.firstChunk = node.lastChunk = static_cast<uint32_t>(compactChunks.size());
+            compactChunks.push_back({begin, size, size, NONE});
+        }
+        chunks = std::move(compactChunks);
+        matches = std::move(compactMatches);
+    }
+
+    [[nodiscard]] size_t nodeCount() const { return nodes.size(); }
+
+    /**
+     * @brief bytes reserved by all pools of the trie
+     */
+    [[nodiscard]] size_t memoryBytes() const {
+        return nodes.capacity() * sizeof(Node) + node16s.capacity() * sizeof(Node16) + node37s.capacity() * sizeof(Node37) +
+               chunks.capacity() * sizeof(MatchChunk) + matches.capacity() * sizeof(const Cast*) +
+               free16.capacity() * sizeof(uint32_t);
+    }
+
+private:
+    static constexpr uint32_t ROOT = 0;
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    enum NodeKind : uint8_t { EMPTY, NODE4, NODE16, NODE37 };
+
+    struct Node {
+        uint32_t firstChunk = NONE;
+        uint32_t lastChunk = NONE;
+        NodeKind kind = EMPTY;
+        uint8_t numChildren = 0;
+        uint8_t keys[4] = {};
+        uint32_t children[4] = {}; // NODE16 and NODE37 keep their pool slot in children[0]
+    };
+
+    struct Node16 {
+        uint8_t keys[16];
+        uint32_t children[16];
+    };
+
+    struct Node37 {
+        uint32_t children[TOTAL_CHILDREN];
+    };
+
+    struct MatchChunk {
+        uint32_t begin;
+        uint32_t size;
+        uint32_t capacity;
+        uint32_t next;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<Node16> node16s;
+    std::vector<Node37> node37s;
+    std::vector<uint32_t> free16;
+    std::vector<MatchChunk> chunks;
+    std::vector<const Cast*> matches;
+
+    [[nodiscard]] uint32_t findChild(const uint32_t index, const uint8_t symbol) const {
+        const Node& node = nodes[index];
+        switch (node.kind) {
+        case NODE4:
+            for (uint8_t i = 0; i < node.numChildren; ++i) {
+                if (node.keys[i] == symbol) return node.children[i];
+            }
+            return NONE;
+        case NODE16: {
+            const Node16& inner = node16s[node.children[0]];
+#ifdef __SSE2__
+            const __m128i hits = _mm_cmpeq_epi8(_mm_set1_epi8(static_cast<char>(symbol)),
+                                                _mm_loadu_si128(reinterpret_cast<const __m128i*>(inner.keys)));
+            const unsigned mask = _mm_movemask_epi8(hits) & ((1u << node.numChildren) - 1);
+            return mask ? inner.children[__builtin_ctz(mask)] : NONE;
+#else
+            for (uint8_t i = 0; i < node.numChildren; ++i) {
+                if (inner.keys[i] == symbol) return inner.children[i];
+            }
+            return NONE;
+#endif
+        }
+        case NODE37:
+            return node37s[node.children[0]].children[symbol];
+        default:
+            return NONE;
+        }
+    }
+
+    void addChild(const uint32_t index, const uint8_t symbol, const uint32_t child) {
+        Node& node = nodes[index];
+        switch (node.kind) {
+        case EMPTY:
+            node.kind = NODE4;
+            [[fallthrough]];
+        case NODE4:
+            if (node.numChildren < 4) {
+                node.keys[node.numChildren] = symbol;
+                node.children[node.numChildren++] = child;
+                return;
+            }
+            growToNode16(node);
+            [[fallthrough]];
+        case NODE16:
+            if (node.numChildren < 16) {
+                Node16& inner = node16s[node.children[0]];
+                inner.keys[node.numChildren] = symbol;
+                inner.children[node.numChildren++] = child;
+                return;
+            }
+            growToNode37(node);
+            [[fallthrough]];
+        case NODE37:
+            node37s[node.children[0]].children[symbol] = child;
+            ++node.numChildren;
+        }
+    }
+
+    void growToNode16(Node& node) {
+        uint32_t slot;
+        if (!free16.empty()) {
+            slot = free16.back();
+            free16.pop_back();
+        } else {
+            slot = static_cast<uint32_t>(node16s.size());
+            node16s.emplace_back();
+        }
+        Node16& grown = node16s[slot];
+        for (uint8_t i = 0; i < node.numChildren; ++i) {
+            grown.keys[i] = node.keys[i];
+            grown.children[i] = node.children[i];
+        }
+        node.children[0] = slot;
+        node.kind = NODE16;
+    }
+
+    void growToNode37(Node& node) {
+        node37s.emplace_back();
+        const uint32_t slot = static_cast<uint32_t>(node37s.size() - 1);
+        const Node16& small = node16s[node.children[0]];
+        Node37& grown = node37s[slot];
+        std::fill(std::begin(grown.children), std::end(grown.children), NONE);
+        for (uint8_t i = 0; i < node.numChildren; ++i) {
+            grown.children[small.keys[i]] = small.children[i];
+        }
+        free16.push_back(node.children[0]);
+        node.children[0] = slot;
+        node.kind = NODE37;
+    }
+
+    void appendMatch(Node& node, const Cast* cast) {
+        if (node.lastChunk == NONE || chunks[node.lastChunk].size == chunks[node.lastChunk].capacity) {
+            const uint32_t capacity = node.lastChunk == NONE ? 1 : chunks[node.lastChunk].capacity * 2;
+            const auto chunk = static_cast<uint32_t>(chunks.size());
+            chunks.push_back({static_cast<uint32_t>(matches.size()), 0, capacity, NONE});
+            matches.resize(matches.size() + capacity);
+            if (node.lastChunk == NONE) {
+                node.firstChunk = chunk;
+            } else {
+                chunks[node.lastChunk].next = chunk;
+            }
+            node.lastChunk = chunk;
+        }
+        MatchChunk& chunk = chunks[node.lastChunk];
+        matches[chunk.begin + chunk.size++] = cast;
+    }
+
+    template <typename Visitor>
+    bool visitMatches(const Node& node, Visitor& visit) const {
+        for (uint32_t chunk = node.firstChunk; chunk != NONE; chunk = chunks[chunk].next) {
+            const Cast* const* first = matches.data() + chunks[chunk].begin;
+            if (visitRun(visit, first, first + chunks[chunk].size)) return true;
+        }
+        return false;
+    }
+};
+
+#endif // COMPACTTRIE_HPP
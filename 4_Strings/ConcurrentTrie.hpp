@@ -0,0 +1,295 @@
+/*
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#ifndef CONCURRENTTRIE_HPP
+#define CONCURRENTTRIE_HPP
+
+#include "JoinUtils.hpp"
+#include "StringKeys.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Prefix trie over the folded notes that is updated in place while
+ * lookups run. Writers are serialized by a mutex; readers take no lock and
+ * never wait, they only announce the epoch they started in. An update walks
+ * the path of its note and publishes new nodes and match entries with release
+ * stores, so its cost depends on the note length and not on the relation size.
+ * Unlinked entries and pruned nodes are kept in a limbo list of their epoch and
+ * freed once no reader can still be inside that epoch (epoch-based
+ * reclamation with three epochs).
+ */
+template <typename Cast = CastRelation>
+class ConcurrentTrie {
+public:
+    ConcurrentTrie() : root(new Node()) {}
+
+    ConcurrentTrie(const ConcurrentTrie&) = delete;
+    ConcurrentTrie& operator=(const ConcurrentTrie&) = delete;
+
+    ~ConcurrentTrie() {
+        freeSubtree(root);
+        for (auto& retired : limbo) {
+            freeRetired(retired);
+        }
+    }
+
+    /**
+     * @brief adds cast under key; returns false if the tuple is already indexed
+     */
+    bool insert(const std::string_view key, const Cast* cast) {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        if (entries.count(cast) != 0) return false;
+
+        Node* node = root;
+        for (const char c : key) {
+            const auto symbol = static_cast<uint8_t>(c);
+            Node* child = node->children[symbol].load(std::memory_order_relaxed);
+            if (child == nullptr) {
+                child = new Node();
+                node->children[symbol].store(child, std::memory_order_release);
+                ++node->childCount;
+            }
+            node = child;
+        }
+
+        // New entries go to the front of the list, readers see either the old or the new head.
+        Entry* head = node->matches.load(std::memory_order_relaxed);
+        Entry* entry = new Entry{cast, {head}, nullptr, node};
+        if (head != nullptr) head->prev = entry;
+        node->matches.store(entry, std::memory_order_release);
+        entries.emplace(cast, entry);
+        ++entryCount;
+        return true;
+    }
+
+    /**
+     * @brief removes cast, which was inserted under key; returns false without
+     * changing the trie if it is not indexed under key. Nodes left without
+     * matches and children are pruned.
+     */
+    bool erase(const std::string_view key, const Cast* cast) {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        const auto found = entries.find(cast);
+        if (found == entries.end()) return false;
+        Entry* entry = found->second;
+
+        std::vector<Node*>& path = pathScratch;
+        path.assign(1, root);
+        for (const char c : key) {
+            Node* child = path.back()->children[static_cast<uint8_t>(c)].load(std::memory_order_relaxed);
+            if (child == nullptr) return false;
+            path.push_back(child);
+        }
+        if (path.back() != entry->node) return false;
+
+        // Readers standing on the entry keep following its next pointer until they leave their epoch.
+        Entry* next = entry->next.load(std::memory_order_relaxed);
+        if (entry->prev == nullptr) {
+            path.back()->matches.store(next, std::memory_order_release);
+        } else {
+            entry->prev->next.store(next, std::memory_order_release);
+        }
+        if (next != nullptr) next->prev = entry->prev;
+        entries.erase(found);
+        --entryCount;
+
+        const uint64_t epoch = globalEpoch.load(std::memory_order_relaxed);
+        limbo[epoch % EPOCHS].entries.push_back(entry);
+        for (size_t depth = key.size(); depth > 0; --depth) {
+            Node* node = path[depth];
+            if (node->childCount != 0 || node->matches.load(std::memory_order_relaxed) != nullptr) break;
+            path[depth - 1]->children[static_cast<uint8_t>(key[depth - 1])].store(nullptr, std::memory_order_release);
+            --path[depth - 1]->childCount;
+            limbo[epoch % EPOCHS].nodes.push_back(node);
+        }
+        tryAdvanceEpoch();
+        return true;
+    }
+
+    void findPrefixMatches(const std::string_view key, std::vector<const Cast*>& results) const {
+        visitPrefixMatches(key, [&](const Cast* const* first, const Cast* const* last) {
+            results.insert(results.end(), first, last);
+        });
+    }
+
+    /**
+     * @brief calls visit(first, last) for the cast tuples whose note is a prefix
+     * of key, one tuple per call; visit must not update this trie and may
+     * return true to stop the lookup
+     */
+    template <typename Visitor>
+    void visitPrefixMatches(const std::string_view key, Visitor&& visit) const {
+        const ReadGuard guard(*this);
+        const Node* node = root;
+        for (const char c : key) {
+            if (visitMatches(node, visit)) return;
+            node = node->children[static_cast<uint8_t>(c)].load(std::memory_order_acquire);
+            if (node == nullptr) return;
+        }
+        visitMatches(node, visit);
+    }
+
+    /**
+     * @brief frees retired nodes and entries whose epoch no reader can still be in
+     */
+    void collect() {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        for (int i = 0; i < EPOCHS; ++i) {
+            tryAdvanceEpoch();
+        }
+    }
+
+    [[nodiscard]] size_t size() const { return entryCount; }
+
+    /**
+     * @brief bytes of the reachable nodes and entries, the writer index and the
+     * retired objects waiting for reclamation; only meaningful without writers
+     */
+    [[nodiscard]] size_t memoryBytes() const {
+        size_t bytes = entryCount * sizeof(Entry) + entries.bucket_count() * sizeof(void*) +
+                       entries.size() * (sizeof(const Cast*) + sizeof(Entry*) + sizeof(void*));
+        std::vector<const Node*> stack{root};
+        while (!stack.empty()) {
+            const Node* node = stack.back();
+            stack.pop_back();
+            bytes += sizeof(Node);
+            for (const auto& child : node->children) {
+                if (const Node* next = child.load(std::memory_order_acquire)) stack.push_back(next);
+            }
+        }
+        for (const auto& retired : limbo) {
+            bytes += retired.nodes.size() * sizeof(Node) + retired.entries.size() * sizeof(Entry);
+        }
+        return bytes;
+    }
+
+private:
+    static constexpr int EPOCHS = 3;
+    static constexpr size_t READER_STRIPES = 64;
+
+    struct Node;
+
+    struct Entry {
+        const Cast* cast;
+        std::atomic<Entry*> next;
+        Entry* prev; // only used by the writer
+        Node* node;  // the node whose list holds the entry, only used by the writer
+    };
+
+    struct Node {
+        std::atomic<Node*> children[TOTAL_CHILDREN] = {};
+        std::atomic<Entry*> matches{nullptr};
+        uint8_t childCount = 0; // only used by the writer
+    };
+
+    struct Retired {
+        std::vector<Node*> nodes;
+        std::vector<Entry*> entries;
+    };
+
+    // Readers of one stripe count themselves in the epoch they entered, stripes keep unrelated threads
+    // off each other's cache lines.
+    struct alignas(64) ReaderStripe {
+        std::atomic<uint32_t> readers[EPOCHS] = {};
+    };
+
+    class ReadGuard {
+    public:
+        explicit ReadGuard(const ConcurrentTrie& trie) : stripe(trie.stripes[readerStripe()]) {
+            while (true) {
+                epoch = trie.globalEpoch.load();
+                stripe.readers[epoch % EPOCHS].fetch_add(1);
+                if (trie.globalEpoch.load() == epoch) break;
+                stripe.readers[epoch % EPOCHS].fetch_sub(1);
+            }
+        }
+
+        ~ReadGuard() { stripe.readers[epoch % EPOCHS].fetch_sub(1, std::memory_order_release); }
+
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+
+    private:
+        ReaderStripe& stripe;
+        uint64_t epoch = 0;
+    };
+
+    Node* root;
+    std::mutex writerMutex;
+    std::atomic<uint64_t> globalEpoch{0};
+    mutable std::array<ReaderStripe, READER_STRIPES> stripes;
+    std::array<Retired, EPOCHS> limbo;
+    std::unordered_map<const Cast*, Entry*> entries; // where every tuple is linked, for erase
+    std::vector<Node*> pathScratch;
+    size_t entryCount = 0;
+
+    static size_t readerStripe() {
+        static std::atomic<size_t> nextStripe{0};
+        thread_local const size_t stripe = nextStripe.fetch_add(1, std::memory_order_relaxed) % READER_STRIPES;
+        return stripe;
+    }
+
+    template <typename Visitor>
+    static bool visitMatches(const Node* node, Visitor& visit) {
+        for (const Entry* entry = node->matches.load(std::memory_order_acquire); entry != nullptr;
+             entry = entry->next.load(std::memory_order_acquire)) {
+            if (visitRun(visit, &entry->cast, &entry->cast + 1)) return true;
+        }
+        return false;
+    }
+
+    // Moving from epoch e to e + 1 needs every reader of e - 1 to be gone. Objects retired in e - 2 were
+    // unlinked before any reader of e - 1 or later started, so their limbo slot is freed and reused for e + 1.
+    void tryAdvanceEpoch() {
+        const uint64_t epoch = globalEpoch.load(std::memory_order_relaxed);
+        const int previous = static_cast<int>((epoch + EPOCHS - 1) % EPOCHS);
+        for (const ReaderStripe& stripe : stripes) {
+            if (stripe.readers[previous].load() != 0) return;
+        }
+        globalEpoch.store(epoch + 1);
+        freeRetired(limbo[(epoch + 1) % EPOCHS]);
+    }
+
+    static void freeRetired(Retired& retired) {
+        for (Node* node : retired.nodes) delete node;
+        for (Entry* entry : retired.entries) delete entry;
+        retired.nodes.clear();
+        retired.entries.clear();
+    }
+
+    static void freeSubtree(Node* root) {
+        std::vector<Node*> stack{root};
+        while (!stack.empty()) {
+            Node* node = stack.back();
+            stack.pop_back();
+            for (Entry* entry = node->matches.load(std::memory_order_relaxed); entry != nullptr;) {
+                Entry* next = entry->next.load(std::memory_order_relaxed);
+                delete entry;
+                entry = next;
+            }
+            for (auto& child : node->children) {
+                if (Node* next = child.load(std::memory_order_relaxed)) stack.push_back(next);
+            }
+            delete node;
+        }
+    }
+};
+
+#endif // CONCURRENTTRIE_HPP
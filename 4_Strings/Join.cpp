@@ -1,151 +1,2003 @@
-#include "JoinUtils.hpp"
+#include <gtest/gtest.h>
 #include <vector>
 #include <memory>
-#include <cctype>
 #include <string_view>
 #include <omp.h>
 #include <algorithm>
+#include <atomic>
+#include <unordered_map>
+#include <optional>
+#include <cmath>
+#include <numeric>
+#include <filesystem>
+#include <fstream>
+#include "Join.hpp"
+#include "JoinUtils.hpp"
+#include "TimerUtil.hpp"
+#include "StringKeys.hpp"
+#include "CompactTrie.hpp"
+#include "RadixTrie.hpp"
+#include "SortedPrefixIndex.hpp"
+#include "LengthHashIndex.hpp"
+#include "AhoCorasick.hpp"
+#include "StringHashTable.hpp"
+#include "SimilarityIndex.hpp"
+#include "BumpArena.hpp"
+#include "SortedTitleIndex.hpp"
+#include "ConcurrentTrie.hpp"
+#include "AllocationCounter.hpp"
 using namespace std;
 
-// Konstanten für Trie-Konfiguration
-static constexpr int ALPHABET_SIZE = 36;
-static constexpr int OTHER_INDEX = ALPHABET_SIZE;
-static constexpr int TOTAL_CHILDREN = ALPHABET_SIZE + 1;
-
+// Cast ist der Tupeltyp, auf den die Trefferlisten zeigen
+template <typename Cast = CastRelation>
 class Trie {
 private:
+    // Knoten und Trefferlisten liegen in den Arenen des Tries und werden nur gemeinsam freigegeben
     struct TrieNode {
-        bool endOfWord = false;
-        vector<const CastRelation*> cast;
-        unique_ptr<TrieNode> children[TOTAL_CHILDREN];
+        TrieNode* children[TOTAL_CHILDREN] = {};
+        const Cast** cast = nullptr;
+        uint32_t castSize = 0;
+        uint32_t castCapacity = 0;
     };
 
-    unique_ptr<TrieNode> root;
+    // Arena 0 gehört der Wurzel und dem seriellen Einfügen, beim parallelen Aufbau hat jeder Thread eine eigene
+    vector<BumpArena> arenas;
+    TrieNode* root;
 
-    static int charToIndex(char c) {
-        c = tolower(c);
-        if (c >= 'a' && c <= 'z') {
-            return c - 'a'; // 0 to 25
-        } else if (c >= '0' && c <= '9') {
-            return 26 + (c - '0'); // 26 to 35
+    // Die Schlüssel sind bereits gefaltet, jedes Zeichen ist direkt der Index des Kindes
+    static void insertBelow(BumpArena& arena, TrieNode* node, string_view note, size_t depth,
+                            const Cast* cast) {
+        for (; depth < note.size(); ++depth) {
+            node = childOrCreate(arena, node, static_cast<uint8_t>(note[depth]));
         }
-        return OTHER_INDEX; // anything else
+
+        // Volle Trefferlisten werden in doppelter Größe neu angelegt, die alte bleibt bis zum Ende in der Arena
+        if (node->castSize == node->castCapacity) {
+            const uint32_t capacity = node->castCapacity == 0 ? 1 : 2 * node->castCapacity;
+            const Cast** grown = arena.allocateArray<const Cast*>(capacity);
+            copy(node->cast, node->cast + node->castSize, grown);
+            node->cast = grown;
+            node->castCapacity = capacity;
+        }
+        node->cast[node->castSize++] = cast;
     }
 
-    static void mergeNodes(TrieNode* this_node, TrieNode* other_node) {
-        if (other_node->endOfWord) {
-            this_node->endOfWord = true;
-            for (const auto* castPtr : other_node->cast) {
-                this_node->cast.push_back(castPtr);
-            }
+    static TrieNode* childOrCreate(BumpArena& arena, TrieNode* node, int index) {
+        if (!node->children[index]) {
+            node->children[index] = arena.create<TrieNode>();
         }
+        return node->children[index];
+    }
 
-        for (int i = 0; i < TOTAL_CHILDREN; i++) {
-            if (other_node->children[i]) {
-                if (!this_node->children[i]) {
-                    this_node->children[i] = move(other_node->children[i]);
-                } else {
-                    mergeNodes(this_node->children[i].get(), other_node->children[i].get());
-                }
+public:
+    Trie() : arenas(1), root(arenas[0].create<TrieNode>()) {}
+
+    void insert(string_view note, const Cast* cast) {
+        insertBelow(arenas[0], root, note, 0, cast);
+    }
+
+    void findPrefixMatches(string_view prefix, vector<const Cast*>& results) const {
+        visitPrefixMatches(prefix, [&](const Cast* const* first, const Cast* const* last) {
+            results.insert(results.end(), first, last);
+        });
+    }
+
+    // Ruft visit(first, last) für die Treffer jedes Knotens auf dem Pfad auf, ohne selbst zu allokieren;
+    // gibt visit true zurück, endet die Suche
+    template <typename Visitor>
+    void visitPrefixMatches(string_view prefix, Visitor&& visit) const {
+        const TrieNode* node = root;
+        for (char c : prefix) {
+            if (node->castSize > 0 && visitRun(visit, node->cast, node->cast + node->castSize)) {
+                return;
             }
+            int index = static_cast<uint8_t>(c);
+            if (!node->children[index]) return;
+            node = node->children[index];
+        }
+        if (node->castSize > 0) {
+            visitRun(visit, node->cast, node->cast + node->castSize);
         }
     }
 
-public:
-    Trie() : root(make_unique<TrieNode>()) {}
+    // Paralleler Aufbau ohne Merge: die Notizen werden nach ihren ersten beiden Zeichen in disjunkte Gruppen
+    // sortiert und jede Gruppe wird von genau einem Thread als eigener Teilbaum unter der Wurzel aufgebaut
+    void bulkLoad(const vector<Cast>& castRelation, const KeyColumn& noteKeys, int numThreads) {
+        static constexpr int SHARD_COUNT = TOTAL_CHILDREN * TOTAL_CHILDREN;
+        static constexpr int SHORT_NOTES = SHARD_COUNT; // Notizen mit weniger als zwei Zeichen
+        auto shardOf = [&](size_t i) {
+            string_view note = noteKeys[i];
+            return note.size() < 2 ? SHORT_NOTES
+                                   : static_cast<uint8_t>(note[0]) * TOTAL_CHILDREN + static_cast<uint8_t>(note[1]);
+        };
 
-    void insert(const CastRelation* cast) const {
-        TrieNode* node = root.get();
-        string_view note(cast->note);
+        // Phase 1: Paralleles Zählen der Gruppengrößen pro Thread
+        vector<size_t> offsets(static_cast<size_t>(numThreads) * (SHARD_COUNT + 1));
+        #pragma omp parallel num_threads(numThreads)
+        {
+            size_t* histogram = offsets.data() + static_cast<size_t>(omp_get_thread_num()) * (SHARD_COUNT + 1);
+            #pragma omp for schedule(static)
+            for (size_t i = 0; i < castRelation.size(); ++i) {
+                ++histogram[shardOf(i)];
+            }
+        }
 
-        for (char c : note) {
-            int index = charToIndex(c);
-            if (!node->children[index]) {
-                node->children[index] = make_unique<TrieNode>();
+        vector<size_t> shardBegin(SHARD_COUNT + 2);
+        size_t running = 0;
+        for (int shard = 0; shard <= SHARD_COUNT; ++shard) {
+            shardBegin[shard] = running;
+            for (int t = 0; t < numThreads; ++t) {
+                size_t& offset = offsets[static_cast<size_t>(t) * (SHARD_COUNT + 1) + shard];
+                const size_t count = offset;
+                offset = running;
+                running += count;
             }
-            node = node->children[index].get();
         }
+        shardBegin[SHARD_COUNT + 1] = running;
 
-        node->endOfWord = true;
-        node->cast.push_back(cast);
-    }
+        // Phase 2: Stabiles Verteilen der Notizen auf ihre Gruppen
+        vector<uint32_t> sorted(castRelation.size());
+        #pragma omp parallel num_threads(numThreads)
+        {
+            size_t* offset = offsets.data() + static_cast<size_t>(omp_get_thread_num()) * (SHARD_COUNT + 1);
+            #pragma omp for schedule(static)
+            for (size_t i = 0; i < castRelation.size(); ++i) {
+                sorted[offset[shardOf(i)]++] = static_cast<uint32_t>(i);
+            }
+        }
 
-    void findPrefixMatches(const string& prefix, vector<const CastRelation*>& results) const {
-        TrieNode* node = root.get();
-        for (char c : prefix) {
-            if (node->endOfWord) {
-                results.insert(results.end(), node->cast.begin(), node->cast.end());
+        // Phase 3: Wurzeln der Teilbäume anlegen, kurze Notizen direkt einfügen
+        vector<pair<int, TrieNode*>> shards;
+        for (int shard = 0; shard < SHARD_COUNT; ++shard) {
+            if (shardBegin[shard + 1] == shardBegin[shard]) continue;
+            TrieNode* first = childOrCreate(arenas[0], root, shard / TOTAL_CHILDREN);
+            shards.emplace_back(shard, childOrCreate(arenas[0], first, shard % TOTAL_CHILDREN));
+        }
+        for (size_t i = shardBegin[SHORT_NOTES]; i < shardBegin[SHORT_NOTES + 1]; ++i) {
+            insertBelow(arenas[0], root, noteKeys[sorted[i]], 0, &castRelation[sorted[i]]);
+        }
+
+        // Phase 4: Teilbäume parallel aufbauen, größte Gruppen zuerst
+        auto shardSize = [&](int shard) { return shardBegin[shard + 1] - shardBegin[shard]; };
+        sort(shards.begin(), shards.end(), [&](const auto& lhs, const auto& rhs) {
+            return shardSize(lhs.first) > shardSize(rhs.first);
+        });
+        if (arenas.size() < static_cast<size_t>(numThreads) + 1) arenas.resize(numThreads + 1);
+        #pragma omp parallel for schedule(dynamic, 1) num_threads(numThreads)
+        for (size_t s = 0; s < shards.size(); ++s) {
+            const auto [shard, subtrie] = shards[s];
+            BumpArena& arena = arenas[omp_get_thread_num() + 1];
+            for (size_t i = shardBegin[shard]; i < shardBegin[shard + 1]; ++i) {
+                insertBelow(arena, subtrie, noteKeys[sorted[i]], 2, &castRelation[sorted[i]]);
             }
-            int index = charToIndex(c);
-            if (!node->children[index]) return;
-            node = node->children[index].get();
         }
-        if (node->endOfWord) {
-            results.insert(results.end(), node->cast.begin(), node->cast.end());
+    }
+
+    // Belegter Speicher aller Knoten inklusive ihrer aktuellen Trefferlisten
+    size_t memoryBytes() const {
+        size_t bytes = 0;
+        vector<const TrieNode*> stack{root};
+        while (!stack.empty()) {
+            const TrieNode* node = stack.back();
+            stack.pop_back();
+            bytes += sizeof(TrieNode) + node->castCapacity * sizeof(const Cast*);
+            for (const TrieNode* child : node->children) {
+                if (child) stack.push_back(child);
+            }
         }
+        return bytes;
     }
 
-    void merge(Trie&& other) {
-        mergeNodes(root.get(), other.root.get());
+    // Von den Arenen reservierter Speicher, inklusive verworfener Trefferlisten und ungenutzter Blockenden
+    size_t reservedBytes() const {
+        size_t bytes = 0;
+        for (const BumpArena& arena : arenas) bytes += arena.reservedBytes();
+        return bytes;
     }
 };
 
 //-------------------------------------------------------------------------------------------------------------------------
 
+// Die Indexe werden über Tupel fester Breite und über Tupel mit String-Heap gleich aufgebaut,
+// sie lesen nur die Schlüssel
+template <typename Cast>
+static Trie<Cast> buildTrie(const vector<Cast>& castRelation, const KeyColumn& noteKeys, int numThreads) {
+    Trie<Cast> trie;
+    trie.bulkLoad(castRelation, noteKeys, numThreads);
+    return trie;
+}
+
+template <typename Cast>
+static CompactTrie<Cast> buildCompactTrie(const vector<Cast>& castRelation, const KeyColumn& noteKeys) {
+    CompactTrie<Cast> trie;
+    for (size_t i = 0; i < castRelation.size(); ++i) {
+        trie.insert(noteKeys[i], &castRelation[i]);
+    }
+    trie.compactMatches();
+    return trie;
+}
+
+template <typename Cast>
+static RadixTrie<Cast> buildRadixTrie(const vector<Cast>& castRelation, const KeyColumn& noteKeys) {
+    RadixTrie<Cast> trie;
+    trie.build(castRelation, noteKeys);
+    return trie;
+}
+
+template <typename Cast>
+static SortedPrefixIndex<Cast> buildSortedPrefixIndex(const vector<Cast>& castRelation, const KeyColumn& noteKeys,
+                                                      int numThreads) {
+    SortedPrefixIndex<Cast> index;
+    index.build(castRelation, noteKeys, numThreads);
+    return index;
+}
+
+template <typename Cast>
+static LengthHashIndex<Cast> buildLengthHashIndex(const vector<Cast>& castRelation, const KeyColumn& noteKeys,
+                                                  int numThreads) {
+    LengthHashIndex<Cast> index;
+    index.build(castRelation, noteKeys, numThreads);
+    return index;
+}
+
+// Der nebenläufige Trie lässt sich weder kopieren noch verschieben und wird an Ort und Stelle gefüllt
+template <typename Cast>
+static void insertNotes(ConcurrentTrie<Cast>& trie, const vector<Cast>& castRelation, const KeyColumn& noteKeys) {
+    for (size_t i = 0; i < castRelation.size(); ++i) {
+        trie.insert(noteKeys[i], &castRelation[i]);
+    }
+}
+
+static SortedTitleIndex buildSortedTitleIndex(const KeyColumn& titleKeys, int numThreads) {
+    SortedTitleIndex index;
+    index.build(titleKeys, numThreads);
+    return index;
+}
+
+static KeyColumn foldNotes(const vector<CastRelation>& castRelation, int numThreads) {
+    return KeyColumn::fold(castRelation, &CastRelation::note, numThreads);
+}
+
+static KeyColumn foldTitles(const vector<TitleRelation>& titleRelation, int numThreads) {
+    return KeyColumn::fold(titleRelation, &TitleRelation::title, numThreads);
+}
+
+static KeyColumn foldNotes(const HeapRelation<HeapCastRelation>& castRelation, int numThreads) {
+    return KeyColumn::foldStrings(castRelation.tuples, [&](const HeapCastRelation& cast) {
+        return castRelation.text(cast.note);
+    }, numThreads);
+}
+
+static KeyColumn foldTitles(const HeapRelation<HeapTitleRelation>& titleRelation, int numThreads) {
+    return KeyColumn::foldStrings(titleRelation.tuples, [&](const HeapTitleRelation& title) {
+        return titleRelation.text(title.title);
+    }, numThreads);
+}
+
+// Paralleles Suchen in zwei Durchläufen, ohne Allokationen pro Titel: zuerst werden die Treffer jedes Titels
+// gezählt, danach schreibt jeder Titel seine Tupel direkt an seine Position im vorab allokierten Ergebnis.
+// Der Zähldurchlauf liest nur den Index und kostet etwa 1 % des Suchens; thread-lokale Ergebnisvektoren in
+// einem Durchlauf mit anschließendem Zusammenführen sind rund dreimal langsamer.
+// makeResult(cast, i) erzeugt das Ergebnistupel eines Treffers für den Titel i.
+template <typename Cast, typename Index, typename MakeResult>
+static vector<ResultRelation> probeTitles(const Index& index, const KeyColumn& titleKeys, int numThreads,
+                                          const MakeResult& makeResult) {
+    const size_t titleCount = titleKeys.size();
+    vector<size_t> offsets(titleCount + 1);
+
+    // Durchlauf 1: Treffer pro Titel zählen
+    #pragma omp parallel for schedule(dynamic, 256) num_threads(numThreads)
+    for (size_t i = 0; i < titleCount; ++i) {
+        size_t count = 0;
+        index.visitPrefixMatches(titleKeys[i], [&](const Cast* const* first, const Cast* const* last) {
+            count += last - first;
+        });
+        offsets[i + 1] = count;
+    }
+    for (size_t i = 0; i < titleCount; ++i) {
+        offsets[i + 1] += offsets[i];
+    }
+
+    // Durchlauf 2: Ergebnistupel direkt in das Ergebnis schreiben
+    vector<ResultRelation> results(offsets.back());
+    #pragma omp parallel for schedule(dynamic, 256) num_threads(numThreads)
+    for (size_t i = 0; i < titleCount; ++i) {
+        ResultRelation* out = results.data() + offsets[i];
+        index.visitPrefixMatches(titleKeys[i], [&](const Cast* const* first, const Cast* const* last) {
+            for (; first != last; ++first) {
+                *out++ = makeResult(**first, i);
+            }
+        });
+    }
+
+    return results;
+}
+
+// Suchen mit Deduplizierung: gleiche Schlüssel werden nur einmal im Index nachgeschlagen, die Treffer jeder
+// Gruppe landen in einer gemeinsamen Liste und werden anschließend auf alle Titel der Gruppe verteilt
+template <typename Cast, typename Index, typename MakeResult>
+static vector<ResultRelation> probeDistinctTitles(const Index& index, const KeyColumn& titleKeys, int numThreads,
+                                                  const MakeResult& makeResult) {
+    const size_t titleCount = titleKeys.size();
+    const KeyGroups groups = KeyGroups::build(titleKeys, numThreads);
+
+    // Durchlauf 1: Treffer pro Gruppe zählen
+    vector<size_t> groupOffsets(groups.size() + 1);
+    #pragma omp parallel for schedule(dynamic, 256) num_threads(numThreads)
+    for (size_t g = 0; g < groups.size(); ++g) {
+        size_t count = 0;
+        index.visitPrefixMatches(titleKeys[groups.representative(g)],
+                                 [&](const Cast* const* first, const Cast* const* last) {
+            count += last - first;
+        });
+        groupOffsets[g + 1] = count;
+    }
+    for (size_t g = 0; g < groups.size(); ++g) {
+        groupOffsets[g + 1] += groupOffsets[g];
+    }
+
+    // Durchlauf 2: Trefferlisten der Gruppen füllen
+    vector<const Cast*> groupMatches(groupOffsets.back());
+    #pragma omp parallel for schedule(dynamic, 256) num_threads(numThreads)
+    for (size_t g = 0; g < groups.size(); ++g) {
+        const Cast** out = groupMatches.data() + groupOffsets[g];
+        index.visitPrefixMatches(titleKeys[groups.representative(g)],
+                                 [&](const Cast* const* first, const Cast* const* last) {
+            out = copy(first, last, out);
+        });
+    }
+
+    // Verteilen: jeder Titel schreibt die Treffer seiner Gruppe an seine Position im Ergebnis
+    vector<size_t> offsets(titleCount + 1);
+    for (size_t i = 0; i < titleCount; ++i) {
+        const uint32_t group = groups.groupOf(i);
+        offsets[i + 1] = offsets[i] + groupOffsets[group + 1] - groupOffsets[group];
+    }
+    vector<ResultRelation> results(offsets.back());
+    #pragma omp parallel for schedule(dynamic, 256) num_threads(numThreads)
+    for (size_t i = 0; i < titleCount; ++i) {
+        const uint32_t group = groups.groupOf(i);
+        ResultRelation* out = results.data() + offsets[i];
+        for (size_t m = groupOffsets[group]; m < groupOffsets[group + 1]; ++m) {
+            *out++ = makeResult(*groupMatches[m], i);
+        }
+    }
+
+    return results;
+}
+
+template <typename Cast, typename Index, typename MakeResult>
+static vector<ResultRelation> probe(const Index& index, const KeyColumn& titleKeys, int numThreads,
+                                    bool deduplicateTitles, const MakeResult& makeResult) {
+    if (deduplicateTitles) {
+        return probeDistinctTitles<Cast>(index, titleKeys, numThreads, makeResult);
+    }
+    return probeTitles<Cast>(index, titleKeys, numThreads, makeResult);
+}
+
+// Ergebnistupel der Relationen fester Breite
+static auto fixedResults(const vector<TitleRelation>& titleRelation) {
+    return [&titleRelation](const CastRelation& cast, size_t i) { return createResultTuple(cast, titleRelation[i]); };
+}
+
+static auto heapResults(const HeapRelation<HeapCastRelation>& castRelation,
+                        const HeapRelation<HeapTitleRelation>& titleRelation) {
+    return [&castRelation, &titleRelation](const HeapCastRelation& cast, size_t i) {
+        return createResultTuple(cast, castRelation.strings, titleRelation.tuples[i], titleRelation.strings);
+    };
+}
+
+template <typename Index>
+static vector<ResultRelation> probeTitles(const Index& index, const vector<TitleRelation>& titleRelation,
+                                          const KeyColumn& titleKeys, int numThreads) {
+    return probeTitles<CastRelation>(index, titleKeys, numThreads, fixedResults(titleRelation));
+}
+
+template <typename Index>
+static vector<ResultRelation> probeDistinctTitles(const Index& index, const vector<TitleRelation>& titleRelation,
+                                                  const KeyColumn& titleKeys, int numThreads) {
+    return probeDistinctTitles<CastRelation>(index, titleKeys, numThreads, fixedResults(titleRelation));
+}
+
+// Baut den Index der gewählten Engine über die Notizen auf und übergibt ihn an function
+template <typename Cast, typename Function>
+static auto withIndex(PrefixJoinEngine engine, const vector<Cast>& castRelation, const KeyColumn& noteKeys,
+                      int numThreads, Function&& function) {
+    switch (engine) {
+    case PrefixJoinEngine::CompactTrie:
+        return function(buildCompactTrie(castRelation, noteKeys));
+    case PrefixJoinEngine::RadixTrie:
+        return function(buildRadixTrie(castRelation, noteKeys));
+    case PrefixJoinEngine::SortedNotes:
+        return function(buildSortedPrefixIndex(castRelation, noteKeys, numThreads));
+    case PrefixJoinEngine::LengthHash:
+        return function(buildLengthHashIndex(castRelation, noteKeys, numThreads));
+    case PrefixJoinEngine::ConcurrentTrie: {
+        ConcurrentTrie<Cast> trie;
+        insertNotes(trie, castRelation, noteKeys);
+        return function(trie);
+    }
+    case PrefixJoinEngine::Trie:
+    default:
+        return function(buildTrie(castRelation, noteKeys, numThreads));
+    }
+}
+
+// Umgekehrte Seiten: die Titel bilden den Index, die Notizen werden in zwei Durchläufen wie in probeTitles
+// dagegen gesucht. Die Treffer einer Notiz sind ein zusammenhängender Lauf von Titeln.
+template <typename Cast, typename MakeResult>
+static vector<ResultRelation> streamNotes(const SortedTitleIndex& index, const vector<Cast>& castRelation,
+                                          const KeyColumn& noteKeys, int numThreads, const MakeResult& makeResult) {
+    vector<size_t> offsets(castRelation.size() + 1);
+    #pragma omp parallel for schedule(dynamic, 256) num_threads(numThreads)
+    for (size_t i = 0; i < castRelation.size(); ++i) {
+        const auto [begin, end] = index.prefixedRange(noteKeys[i]);
+        offsets[i + 1] = end - begin;
+    }
+    for (size_t i = 0; i < castRelation.size(); ++i) {
+        offsets[i + 1] += offsets[i];
+    }
+
+    vector<ResultRelation> results(offsets.back());
+    #pragma omp parallel for schedule(dynamic, 256) num_threads(numThreads)
+    for (size_t i = 0; i < castRelation.size(); ++i) {
+        ResultRelation* out = results.data() + offsets[i];
+        const Cast& cast = castRelation[i];
+        index.visitPrefixedTitles(noteKeys[i], [&](const uint32_t* first, const uint32_t* last) {
+            for (; first != last; ++first) {
+                *out++ = makeResult(cast, *first);
+            }
+        });
+    }
+
+    return results;
+}
+
+// Treffer pro Titel bei umgekehrten Seiten: jede Notiz markiert Anfang und Ende ihres Laufs in der sortierten
+// Reihenfolge, die Präfixsumme über die Markierungen ergibt die Anzahl für jede Position. Alle Threads schreiben
+// in dasselbe Feld, der Speicher wächst also nicht mit der Anzahl der Threads
+static vector<uint32_t> titleMatchCounts(const SortedTitleIndex& index, const KeyColumn& noteKeys, int numThreads) {
+    vector<atomic<int64_t>> delta(index.size() + 1);
+    #pragma omp parallel for schedule(static) num_threads(numThreads)
+    for (size_t i = 0; i < noteKeys.size(); ++i) {
+        const auto [begin, end] = index.prefixedRange(noteKeys[i]);
+        if (begin == end) continue;
+        delta[begin].fetch_add(1, memory_order_relaxed);
+        delta[end].fetch_sub(1, memory_order_relaxed);
+    }
+
+    vector<uint32_t> counts(index.size());
+    int64_t running = 0;
+    for (uint32_t position = 0; position < index.size(); ++position) {
+        running += delta[position].load(memory_order_relaxed);
+        counts[index.sortedTitle(position)] = static_cast<uint32_t>(running);
+    }
+    return counts;
+}
+
+static double averageLength(const KeyColumn& keys) {
+    size_t symbols = 0;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        symbols += keys[i].size();
+    }
+    return keys.size() == 0 ? 0.0 : static_cast<double>(symbols) / static_cast<double>(keys.size());
+}
+
+// Kostenmodell für die Wahl der Aufbauseite in Nanosekunden, gemessen in TitleBuildSideCrossover: der Trie über die
+// Notizen zahlt jedes Symbol jeder Notiz beim Aufbau und die Symbole jedes Titels bis zur längsten Notiz beim
+// Suchen, der sortierte Titelindex zahlt das Sortieren der Titel und zwei Binärsuchen pro Notiz innerhalb des
+// Bereichs ihres ersten Symbols
+static constexpr double TRIE_BUILD_SYMBOL_NS = 10.0;
+static constexpr double TRIE_PROBE_SYMBOL_NS = 3.0;
+static constexpr double TITLE_SORT_COMPARISON_NS = 12.0;
+static constexpr double TITLE_SEARCH_STEP_NS = 14.0;
+
+static PrefixJoinEngine chooseBuildSide(const KeyColumn& noteKeys, const KeyColumn& titleKeys) {
+    const double notes = static_cast<double>(noteKeys.size());
+    const double titles = static_cast<double>(titleKeys.size());
+    const double noteLength = averageLength(noteKeys);
+    const double probedLength = min(averageLength(titleKeys), noteLength + 1.0);
+
+    const double noteSide = TRIE_BUILD_SYMBOL_NS * notes * noteLength + TRIE_PROBE_SYMBOL_NS * titles * probedLength;
+    const double titleSide = TITLE_SORT_COMPARISON_NS * titles * log2(titles + 1.0) +
+                             TITLE_SEARCH_STEP_NS * notes * 2.0 * log2(titles / TOTAL_CHILDREN + 1.0);
+    return titleSide < noteSide ? PrefixJoinEngine::SortedTitles : PrefixJoinEngine::Trie;
+}
+
+static PrefixJoinEngine resolveEngine(PrefixJoinEngine engine, const KeyColumn& noteKeys, const KeyColumn& titleKeys) {
+    return engine == PrefixJoinEngine::Adaptive ? chooseBuildSide(noteKeys, titleKeys) : engine;
+}
+
+// Gemeinsamer Ablauf aller Engines auf den bereits normalisierten Schlüsseln beider Seiten
+template <typename Cast, typename MakeResult>
+static vector<ResultRelation> prefixJoin(const vector<Cast>& castRelation, const KeyColumn& noteKeys,
+                                         const KeyColumn& titleKeys, int numThreads, PrefixJoinEngine engine,
+                                         bool deduplicateTitles, const MakeResult& makeResult) {
+    engine = resolveEngine(engine, noteKeys, titleKeys);
+    if (engine == PrefixJoinEngine::SortedTitles) {
+        return streamNotes(buildSortedTitleIndex(titleKeys, numThreads), castRelation, noteKeys, numThreads,
+                           makeResult);
+    }
+    return withIndex(engine, castRelation, noteKeys, numThreads, [&](const auto& index) {
+        return probe<Cast>(index, titleKeys, numThreads, deduplicateTitles, makeResult);
+    });
+}
+
+vector<ResultRelation> performJoin(const vector<CastRelation>& castRelation,
+                                    const vector<TitleRelation>& titleRelation,
+                                    int numThreads,
+                                    PrefixJoinEngine engine,
+                                    bool deduplicateTitles) {
+    // Beide Seiten werden genau einmal normalisiert, alle Engines arbeiten nur noch auf den Schlüsseln
+    const KeyColumn noteKeys = foldNotes(castRelation, numThreads);
+    const KeyColumn titleKeys = foldTitles(titleRelation, numThreads);
+    return prefixJoin(castRelation, noteKeys, titleKeys, numThreads, engine, deduplicateTitles,
+                      fixedResults(titleRelation));
+}
+
+vector<ResultRelation> performJoin(const vector<CastRelation>& castRelation,
+                                    const vector<TitleRelation>& titleRelation,
+                                    int numThreads,
+                                    PrefixJoinEngine engine) {
+    return performJoin(castRelation, titleRelation, numThreads, engine, false);
+}
+
 vector<ResultRelation> performJoin(const vector<CastRelation>& castRelation,
                                     const vector<TitleRelation>& titleRelation,
                                     int numThreads) {
-    // Setze die Anzahl der OpenMP-Threads
-    omp_set_num_threads(numThreads);
+    return performJoin(castRelation, titleRelation, numThreads, PrefixJoinEngine::Trie);
+}
 
-    vector<Trie> localTries(numThreads);
+// Die Schlüssel werden direkt aus den String-Heaps gefaltet, die Ergebnistupel erst beim Schreiben ausgepackt
+vector<ResultRelation> performJoin(const HeapRelation<HeapCastRelation>& castRelation,
+                                    const HeapRelation<HeapTitleRelation>& titleRelation,
+                                    int numThreads,
+                                    PrefixJoinEngine engine,
+                                    bool deduplicateTitles) {
+    const KeyColumn noteKeys = foldNotes(castRelation, numThreads);
+    const KeyColumn titleKeys = foldTitles(titleRelation, numThreads);
+    return prefixJoin(castRelation.tuples, noteKeys, titleKeys, numThreads, engine, deduplicateTitles,
+                      heapResults(castRelation, titleRelation));
+}
+
+vector<ResultRelation> performJoin(const HeapRelation<HeapCastRelation>& castRelation,
+                                    const HeapRelation<HeapTitleRelation>& titleRelation,
+                                    int numThreads,
+                                    PrefixJoinEngine engine) {
+    return performJoin(castRelation, titleRelation, numThreads, engine, false);
+}
+
+vector<ResultRelation> performJoin(const HeapRelation<HeapCastRelation>& castRelation,
+                                    const HeapRelation<HeapTitleRelation>& titleRelation,
+                                    int numThreads) {
+    return performJoin(castRelation, titleRelation, numThreads, PrefixJoinEngine::Trie);
+}
 
-    // Phase 1: Paralleles Einfügen in lokale Tries
+// Spalten der Spaltentabellen, über die der Präfix-Join läuft
+static constexpr size_t NOTE_COLUMN = 4;
+static constexpr size_t TITLE_COLUMN = 1;
+
+static vector<uint32_t> tableRows(size_t count) {
+    vector<uint32_t> rows(count);
+    iota(rows.begin(), rows.end(), 0);
+    return rows;
+}
+
+// Bei Spaltentabellen zeigen die Indexe auf Zeilennummern, gelesen werden nur die Spalten der Notizen und Titel;
+// die übrigen Spalten werden erst beim Schreiben der Treffer eingesammelt
+vector<ResultRelation> performJoin(const CastTable& castTable,
+                                    const TitleTable& titleTable,
+                                    int numThreads,
+                                    PrefixJoinEngine engine,
+                                    bool deduplicateTitles) {
+    const vector<uint32_t> castRows = tableRows(castTable.size());
+    const vector<uint32_t> titleRows = tableRows(titleTable.size());
+    const auto& notes = castTable.column<NOTE_COLUMN>();
+    const auto& titles = titleTable.column<TITLE_COLUMN>();
+    const KeyColumn noteKeys = KeyColumn::foldStrings(castRows, [&](uint32_t row) {
+        return fixedText(notes[row]);
+    }, numThreads);
+    const KeyColumn titleKeys = KeyColumn::foldStrings(titleRows, [&](uint32_t row) {
+        return fixedText(titles[row]);
+    }, numThreads);
+    return prefixJoin(castRows, noteKeys, titleKeys, numThreads, engine, deduplicateTitles,
+                      [&](const uint32_t& castRow, size_t titleRow) {
+        return createResultTuple(castTable, castRow, titleTable, titleRow);
+    });
+}
+
+vector<ResultRelation> performJoin(const CastTable& castTable,
+                                    const TitleTable& titleTable,
+                                    int numThreads,
+                                    PrefixJoinEngine engine) {
+    return performJoin(castTable, titleTable, numThreads, engine, false);
+}
+
+vector<ResultRelation> performJoin(const CastTable& castTable,
+                                    const TitleTable& titleTable,
+                                    int numThreads) {
+    return performJoin(castTable, titleTable, numThreads, PrefixJoinEngine::Trie);
+}
+
+// Aggregierte Modi: die Treffer eines Knotens werden nur über die Länge ihrer Läufe gezählt,
+// es werden weder Ergebnistupel noch Trefferlisten erzeugt
+template <typename Index>
+static size_t countMatches(const Index& index, string_view key) {
+    size_t count = 0;
+    index.visitPrefixMatches(key, [&](const CastRelation* const* first, const CastRelation* const* last) {
+        count += last - first;
+    });
+    return count;
+}
+
+// Für die Bitmap genügt der erste nichtleere Lauf
+template <typename Index>
+static bool hasMatch(const Index& index, string_view key) {
+    bool found = false;
+    index.visitPrefixMatches(key, [&](const CastRelation* const* first, const CastRelation* const* last) {
+        found = first != last;
+        return found;
+    });
+    return found;
+}
+
+vector<uint32_t> countPrefixMatches(const vector<CastRelation>& castRelation,
+                                    const vector<TitleRelation>& titleRelation,
+                                    int numThreads,
+                                    PrefixJoinEngine engine) {
+    const KeyColumn noteKeys = foldNotes(castRelation, numThreads);
+    const KeyColumn titleKeys = foldTitles(titleRelation, numThreads);
+    engine = resolveEngine(engine, noteKeys, titleKeys);
+    if (engine == PrefixJoinEngine::SortedTitles) {
+        return titleMatchCounts(buildSortedTitleIndex(titleKeys, numThreads), noteKeys, numThreads);
+    }
+    return withIndex(engine, castRelation, noteKeys, numThreads, [&](const auto& index) {
+        vector<uint32_t> counts(titleRelation.size());
+        #pragma omp parallel for schedule(dynamic, 256) num_threads(numThreads)
+        for (size_t i = 0; i < titleRelation.size(); ++i) {
+            counts[i] = static_cast<uint32_t>(countMatches(index, titleKeys[i]));
+        }
+        return counts;
+    });
+}
+
+uint64_t totalPrefixMatches(const vector<CastRelation>& castRelation,
+                            const vector<TitleRelation>& titleRelation,
+                            int numThreads,
+                            PrefixJoinEngine engine) {
+    const KeyColumn noteKeys = foldNotes(castRelation, numThreads);
+    const KeyColumn titleKeys = foldTitles(titleRelation, numThreads);
+    engine = resolveEngine(engine, noteKeys, titleKeys);
+    if (engine == PrefixJoinEngine::SortedTitles) {
+        const SortedTitleIndex index = buildSortedTitleIndex(titleKeys, numThreads);
+        uint64_t total = 0;
+        #pragma omp parallel for schedule(static) reduction(+ : total) num_threads(numThreads)
+        for (size_t i = 0; i < castRelation.size(); ++i) {
+            const auto [begin, end] = index.prefixedRange(noteKeys[i]);
+            total += end - begin;
+        }
+        return total;
+    }
+    return withIndex(engine, castRelation, noteKeys, numThreads, [&](const auto& index) {
+        uint64_t total = 0;
+        #pragma omp parallel for schedule(dynamic, 256) reduction(+ : total) num_threads(numThreads)
+        for (size_t i = 0; i < titleRelation.size(); ++i) {
+            total += countMatches(index, titleKeys[i]);
+        }
+        return total;
+    });
+}
+
+vector<uint64_t> semiJoinTitles(const vector<CastRelation>& castRelation,
+                                const vector<TitleRelation>& titleRelation,
+                                int numThreads,
+                                PrefixJoinEngine engine) {
+    const KeyColumn noteKeys = foldNotes(castRelation, numThreads);
+    const KeyColumn titleKeys = foldTitles(titleRelation, numThreads);
+    engine = resolveEngine(engine, noteKeys, titleKeys);
+    if (engine == PrefixJoinEngine::SortedTitles) {
+        const vector<uint32_t> counts = titleMatchCounts(buildSortedTitleIndex(titleKeys, numThreads), noteKeys,
+                                                         numThreads);
+        vector<uint64_t> bitmap((titleRelation.size() + 63) / 64);
+        for (size_t i = 0; i < counts.size(); ++i) {
+            bitmap[i / 64] |= static_cast<uint64_t>(counts[i] != 0) << (i % 64);
+        }
+        return bitmap;
+    }
+    return withIndex(engine, castRelation, noteKeys, numThreads, [&](const auto& index) {
+        // Jede Iteration füllt genau ein Wort der Bitmap, damit sich die Threads nicht in die Quere kommen
+        vector<uint64_t> bitmap((titleRelation.size() + 63) / 64);
+        #pragma omp parallel for schedule(dynamic, 16) num_threads(numThreads)
+        for (size_t word = 0; word < bitmap.size(); ++word) {
+            uint64_t bits = 0;
+            const size_t end = min(titleRelation.size(), (word + 1) * 64);
+            for (size_t i = word * 64; i < end; ++i) {
+                bits |= static_cast<uint64_t>(hasMatch(index, titleKeys[i])) << (i % 64);
+            }
+            bitmap[word] = bits;
+        }
+        return bitmap;
+    });
+}
+
+static AhoCorasick buildAhoCorasick(const vector<CastRelation>& castRelation, const KeyColumn& noteKeys) {
+    AhoCorasick automaton;
+    automaton.build(castRelation, noteKeys);
+    return automaton;
+}
+
+// Ein Durchlauf des Automaten über einen Titel, je nach Modus über alle Positionen oder nur das Ende
+template <typename Visitor>
+static void visitNotes(const AhoCorasick& automaton, string_view key, NoteMatch match, AhoCorasick::SeenKeys& seen,
+                       Visitor&& visit) {
+    if (match == NoteMatch::Suffix) {
+        automaton.visitSuffixNotes(key, visit);
+    } else {
+        automaton.visitContainedNotes(key, seen, visit);
+    }
+}
+
+// Zwei Durchläufe wie in probeTitles, jeder Thread hält eigene Markierungen der bereits gemeldeten Notizen
+static vector<ResultRelation> scanTitles(const AhoCorasick& automaton, const vector<TitleRelation>& titleRelation,
+                                         const KeyColumn& titleKeys, int numThreads, NoteMatch match) {
+    vector<size_t> offsets(titleRelation.size() + 1);
     #pragma omp parallel num_threads(numThreads)
     {
-        int thread_id = omp_get_thread_num();
-        #pragma omp for schedule(static)
-        for (const auto & i : castRelation) {
-            localTries[thread_id].insert(&i);
+        AhoCorasick::SeenKeys seen = automaton.newSeenKeys();
+        #pragma omp for schedule(dynamic, 256)
+        for (size_t i = 0; i < titleRelation.size(); ++i) {
+            size_t count = 0;
+            visitNotes(automaton, titleKeys[i], match, seen,
+                       [&](const CastRelation* const* first, const CastRelation* const* last) { count += last - first; });
+            offsets[i + 1] = count;
         }
     }
+    for (size_t i = 0; i < titleRelation.size(); ++i) {
+        offsets[i + 1] += offsets[i];
+    }
 
-    // Phase 2: Zusammenführen der lokalen Tries
-    Trie globalTrie;
-    for (auto& lt : localTries) {
-        globalTrie.merge(move(lt));
+    vector<ResultRelation> results(offsets.back());
+    #pragma omp parallel num_threads(numThreads)
+    {
+        AhoCorasick::SeenKeys seen = automaton.newSeenKeys();
+        #pragma omp for schedule(dynamic, 256)
+        for (size_t i = 0; i < titleRelation.size(); ++i) {
+            ResultRelation* out = results.data() + offsets[i];
+            const TitleRelation& title = titleRelation[i];
+            visitNotes(automaton, titleKeys[i], match, seen,
+                       [&](const CastRelation* const* first, const CastRelation* const* last) {
+                for (; first != last; ++first) {
+                    *out++ = createResultTuple(**first, title);
+                }
+            });
+        }
     }
 
-    // Phase 3: Paralleles Suchen und Sammeln der Ergebnisse
-    vector<ResultRelation> globalResults;
+    return results;
+}
+
+vector<ResultRelation> performContainmentJoin(const vector<CastRelation>& castRelation,
+                                              const vector<TitleRelation>& titleRelation,
+                                              int numThreads,
+                                              NoteMatch match) {
+    const KeyColumn noteKeys = foldNotes(castRelation, numThreads);
+    const KeyColumn titleKeys = foldTitles(titleRelation, numThreads);
+    return scanTitles(buildAhoCorasick(castRelation, noteKeys), titleRelation, titleKeys, numThreads, match);
+}
+
+// Gleichheitsverbund wie der Integer-Hash-Join: Hashtabelle über die Titel, paralleles Suchen der Notizen
+// mit thread-lokalen Ergebnissen
+vector<ResultRelation> performEqualityJoin(const vector<CastRelation>& castRelation,
+                                           const vector<TitleRelation>& titleRelation,
+                                           int numThreads) {
+    const KeyColumn noteKeys = foldNotes(castRelation, numThreads);
+    const KeyColumn titleKeys = foldTitles(titleRelation, numThreads);
+    StringHashTable table;
+    table.build(titleKeys, numThreads);
+
     vector<vector<ResultRelation>> threadResults(numThreads);
+    #pragma omp parallel num_threads(numThreads)
+    {
+        vector<ResultRelation>& localResults = threadResults[omp_get_thread_num()];
+        #pragma omp for schedule(static, 512) nowait
+        for (size_t i = 0; i < castRelation.size(); ++i) {
+            table.visitEqual(noteKeys[i], [&](uint32_t title) {
+                localResults.push_back(createResultTuple(castRelation[i], titleRelation[title]));
+            });
+        }
+    }
+
+    size_t totalSize = 0;
+    for (const auto& local : threadResults) {
+        totalSize += local.size();
+    }
+    vector<ResultRelation> results;
+    results.reserve(totalSize);
+    for (auto& local : threadResults) {
+        move(local.begin(), local.end(), back_inserter(results));
+    }
+    return results;
+}
+
+static constexpr uint32_t SIMILARITY_QGRAM_LENGTH = 2;
+
+static QGramIndex buildQGramIndex(const KeyColumn& titleKeys, uint32_t qGramLength, uint32_t maxDistance) {
+    QGramIndex index(qGramLength, maxDistance);
+    index.build(titleKeys);
+    return index;
+}
 
+// Ähnlichkeitsverbund: jede verschiedene Notiz wird einmal gegen den q-Gramm-Index der Titel gefiltert und verifiziert,
+// die gefundenen Titel werden danach auf alle Cast-Tupel mit dieser Notiz verteilt
+static vector<ResultRelation> similarityJoin(const QGramIndex& index, const vector<CastRelation>& castRelation,
+                                             const vector<TitleRelation>& titleRelation, const KeyColumn& noteKeys,
+                                             int numThreads, SimilarityStats& stats) {
+    const KeyGroups groups = KeyGroups::build(noteKeys, numThreads);
+    vector<vector<uint32_t>> groupMatches(groups.size());
+    vector<SimilarityStats> threadStats(numThreads);
     #pragma omp parallel num_threads(numThreads)
     {
-        int thread_id = omp_get_thread_num();
-        vector<ResultRelation>& localResults = threadResults[thread_id];
-        localResults.reserve(titleRelation.size() * 2 / numThreads); // Heuristische Reserve
+        QGramIndex::Scratch scratch = index.newScratch();
+        SimilarityStats& localStats = threadStats[omp_get_thread_num()];
+        #pragma omp for schedule(dynamic, 64)
+        for (size_t g = 0; g < groups.size(); ++g) {
+            index.visitSimilar(noteKeys[groups.representative(g)], scratch, localStats,
+                               [&](uint32_t title) { groupMatches[g].push_back(title); });
+        }
+    }
+    stats = {};
+    for (const auto& local : threadStats) {
+        stats += local;
+    }
 
-        #pragma omp for schedule(dynamic, 256)
-        for (const auto & title : titleRelation) {
-            vector<const CastRelation*> prefixMatches;
-            prefixMatches.reserve(10);
-            globalTrie.findPrefixMatches(title.title, prefixMatches);
-            for (const auto* cast : prefixMatches) {
-                localResults.emplace_back(createResultTuple(*cast, title));
+    vector<size_t> offsets(castRelation.size() + 1);
+    for (size_t i = 0; i < castRelation.size(); ++i) {
+        offsets[i + 1] = offsets[i] + groupMatches[groups.groupOf(i)].size();
+    }
+    vector<ResultRelation> results(offsets.back());
+    #pragma omp parallel for schedule(dynamic, 256) num_threads(numThreads)
+    for (size_t i = 0; i < castRelation.size(); ++i) {
+        ResultRelation* out = results.data() + offsets[i];
+        for (const uint32_t title : groupMatches[groups.groupOf(i)]) {
+            *out++ = createResultTuple(castRelation[i], titleRelation[title]);
+        }
+    }
+    return results;
+}
+
+vector<ResultRelation> performSimilarityJoin(const vector<CastRelation>& castRelation,
+                                             const vector<TitleRelation>& titleRelation,
+                                             int numThreads,
+                                             uint32_t maxDistance) {
+    const KeyColumn noteKeys = foldNotes(castRelation, numThreads);
+    const KeyColumn titleKeys = foldTitles(titleRelation, numThreads);
+    SimilarityStats stats;
+    return similarityJoin(buildQGramIndex(titleKeys, SIMILARITY_QGRAM_LENGTH, maxDistance), castRelation, titleRelation,
+                          noteKeys, numThreads, stats);
+}
+
+//-------------------------------------------------------------------------------------------------------------------------
+
+// Die Relationen, ihre gefalteten Schlüssel und das sortierte Ergebnis des Trie-Joins als Referenz werden einmal für
+// alle Tests geladen, jeder Test prüft nur noch seine eigene Variante dagegen
+class StringJoinTest : public ::testing::Test {
+protected:
+    static void SetUpTestSuite() {
+        castRelation = loadCastRelation(DATA_DIRECTORY + std::string("cast_info_uniform.csv"), 1000000);
+        titleRelation = loadTitleRelation(DATA_DIRECTORY + std::string("title_info_uniform.csv"), 1000000);
+        noteKeys = foldNotes(castRelation, 8);
+        titleKeys = foldTitles(titleRelation, 8);
+        referenceJoin = performJoin(castRelation, titleRelation, 8, PrefixJoinEngine::Trie);
+        std::sort(referenceJoin.begin(), referenceJoin.end());
+    }
+
+    static void TearDownTestSuite() {
+        castRelation = {};
+        titleRelation = {};
+        noteKeys = {};
+        titleKeys = {};
+        referenceJoin = {};
+    }
+
+    static inline vector<CastRelation> castRelation;
+    static inline vector<TitleRelation> titleRelation;
+    static inline KeyColumn noteKeys;
+    static inline KeyColumn titleKeys;
+    static inline vector<ResultRelation> referenceJoin;
+};
+
+// Zählt die Treffer aller Titel, ohne Ergebnistupel zu erzeugen
+template <typename Index>
+static size_t countLookups(const Index& index, const KeyColumn& titleKeys) {
+    size_t matches = 0;
+    vector<const CastRelation*> prefixMatches;
+    for (size_t i = 0; i < titleKeys.size(); ++i) {
+        prefixMatches.clear();
+        index.findPrefixMatches(titleKeys[i], prefixMatches);
+        matches += prefixMatches.size();
+    }
+    return matches;
+}
+
+TEST_F(StringJoinTest, CompactTrieMemoryAndLookupThroughput) {
+    const Trie trie = buildTrie(castRelation, noteKeys, 1);
+    const CompactTrie compactTrie = buildCompactTrie(castRelation, noteKeys);
+
+    Timer trieTimer("Trie lookups");
+    trieTimer.start();
+    const size_t trieMatches = countLookups(trie, titleKeys);
+    trieTimer.pause();
+
+    Timer compactTimer("CompactTrie lookups");
+    compactTimer.start();
+    const size_t compactMatches = countLookups(compactTrie, titleKeys);
+    compactTimer.pause();
+    EXPECT_EQ(trieMatches, compactMatches);
+
+    const double notes = static_cast<double>(castRelation.size());
+    std::cout << "Trie:        " << trie.memoryBytes() / notes << " bytes per note, "
+              << titleRelation.size() / (trieTimer.getPrintTime() / 1000.0) << " lookups/s" << std::endl;
+    std::cout << "CompactTrie: " << compactTrie.memoryBytes() / notes << " bytes per note, "
+              << compactTrie.nodeCount() << " nodes, "
+              << titleRelation.size() / (compactTimer.getPrintTime() / 1000.0) << " lookups/s" << std::endl;
+
+    auto result = performJoin(castRelation, titleRelation, 8, PrefixJoinEngine::CompactTrie);
+    std::sort(result.begin(), result.end());
+    EXPECT_TRUE(result == referenceJoin);
+    std::cout << "Result size: " << result.size() << std::endl;
+}
+
+TEST_F(StringJoinTest, TrieBulkLoadScaling) {
+    size_t expectedMatches = 0;
+    for (int numThreads : {1, 2, 4, 8}) {
+        Timer timer("Trie bulk load");
+        timer.start();
+        const Trie trie = buildTrie(castRelation, noteKeys, numThreads);
+        timer.pause();
+
+        const size_t matches = countLookups(trie, titleKeys);
+        if (numThreads == 1) expectedMatches = matches;
+        EXPECT_EQ(matches, expectedMatches);
+        std::cout << "Trie bulk load with " << numThreads << " threads: " << timer << std::endl;
+    }
+}
+
+TEST_F(StringJoinTest, TrieArenaBuildAndTeardown) {
+    // Serieller Aufbau über insert als Referenz für den parallelen Aufbau in die Thread-Arenen
+    optional<Trie<>> serial(in_place);
+    for (size_t i = 0; i < castRelation.size(); ++i) {
+        serial->insert(noteKeys[i], &castRelation[i]);
+    }
+    const size_t expectedMatches = countLookups(*serial, titleKeys);
+    serial.reset();
+
+    for (int numThreads : {1, 8}) {
+        Timer buildTimer("Trie arena build");
+        buildTimer.start();
+        optional<Trie<>> trie(buildTrie(castRelation, noteKeys, numThreads));
+        buildTimer.pause();
+        EXPECT_EQ(countLookups(*trie, titleKeys), expectedMatches);
+
+        const double live = static_cast<double>(trie->memoryBytes());
+        const double reserved = static_cast<double>(trie->reservedBytes());
+        Timer teardownTimer("Trie arena teardown");
+        teardownTimer.start();
+        trie.reset();
+        teardownTimer.pause();
+
+        std::cout << "Trie with " << numThreads << " threads: build " << buildTimer.getPrintTime()
+                  << " ms, teardown " << teardownTimer.getPrintTime() << " ms, " << live / (1024 * 1024)
+                  << " MiB live of " << reserved / (1024 * 1024) << " MiB reserved ("
+                  << 100.0 * (1.0 - live / reserved) << "% fragmentation)" << std::endl;
+    }
+}
+
+TEST_F(StringJoinTest, RadixTriePathCompression) {
+    const CompactTrie compactTrie = buildCompactTrie(castRelation, noteKeys);
+    const RadixTrie radixTrie = buildRadixTrie(castRelation, noteKeys);
+
+    Timer compactTimer("CompactTrie lookups");
+    compactTimer.start();
+    const size_t compactMatches = countLookups(compactTrie, titleKeys);
+    compactTimer.pause();
+
+    Timer radixTimer("RadixTrie lookups");
+    radixTimer.start();
+    const size_t radixMatches = countLookups(radixTrie, titleKeys);
+    radixTimer.pause();
+    EXPECT_EQ(compactMatches, radixMatches);
+
+    const double notes = static_cast<double>(castRelation.size());
+    std::cout << "CompactTrie: " << compactTrie.nodeCount() << " nodes, " << compactTrie.memoryBytes() / notes
+              << " bytes per note, " << titleRelation.size() / (compactTimer.getPrintTime() / 1000.0) << " lookups/s" << std::endl;
+    std::cout << "RadixTrie:   " << radixTrie.nodeCount() << " nodes, " << radixTrie.memoryBytes() / notes
+              << " bytes per note, " << titleRelation.size() / (radixTimer.getPrintTime() / 1000.0) << " lookups/s" << std::endl;
+
+    auto result = performJoin(castRelation, titleRelation, 8, PrefixJoinEngine::RadixTrie);
+    std::sort(result.begin(), result.end());
+    EXPECT_TRUE(result == referenceJoin);
+}
+
+TEST_F(StringJoinTest, SortedNotesAgainstTrie) {
+    Timer trieBuild("Trie build");
+    trieBuild.start();
+    const Trie trie = buildTrie(castRelation, noteKeys, 8);
+    trieBuild.pause();
+
+    Timer sortedBuild("Sorted notes build");
+    sortedBuild.start();
+    const SortedPrefixIndex sortedIndex = buildSortedPrefixIndex(castRelation, noteKeys, 8);
+    sortedBuild.pause();
+
+    Timer trieTimer("Trie lookups");
+    trieTimer.start();
+    const size_t trieMatches = countLookups(trie, titleKeys);
+    trieTimer.pause();
+
+    Timer sortedTimer("Sorted notes lookups");
+    sortedTimer.start();
+    const size_t sortedMatches = countLookups(sortedIndex, titleKeys);
+    sortedTimer.pause();
+    EXPECT_EQ(trieMatches, sortedMatches);
+
+    std::cout << "Trie:         build " << trieBuild << ", " << trie.memoryBytes() / (1024 * 1024) << " MiB, "
+              << titleRelation.size() / (trieTimer.getPrintTime() / 1000.0) << " lookups/s" << std::endl;
+    std::cout << "Sorted notes: build " << sortedBuild << ", " << sortedIndex.memoryBytes() / (1024 * 1024) << " MiB, "
+              << sortedIndex.distinctKeys() << " distinct notes, "
+              << titleRelation.size() / (sortedTimer.getPrintTime() / 1000.0) << " lookups/s" << std::endl;
+
+    auto result = performJoin(castRelation, titleRelation, 8, PrefixJoinEngine::SortedNotes);
+    std::sort(result.begin(), result.end());
+    EXPECT_TRUE(result == referenceJoin);
+}
+
+TEST_F(StringJoinTest, LengthHashAgainstTrie) {
+    const Trie trie = buildTrie(castRelation, noteKeys, 8);
+    Timer hashBuild("Length hash build");
+    hashBuild.start();
+    const LengthHashIndex hashIndex = buildLengthHashIndex(castRelation, noteKeys, 8);
+    hashBuild.pause();
+
+    Timer trieTimer("Trie lookups");
+    trieTimer.start();
+    const size_t trieMatches = countLookups(trie, titleKeys);
+    trieTimer.pause();
+
+    Timer hashTimer("Length hash lookups");
+    hashTimer.start();
+    const size_t hashMatches = countLookups(hashIndex, titleKeys);
+    hashTimer.pause();
+    EXPECT_EQ(trieMatches, hashMatches);
+
+    std::cout << "Trie:        " << trie.memoryBytes() / (1024 * 1024) << " MiB, "
+              << titleRelation.size() / (trieTimer.getPrintTime() / 1000.0) << " lookups/s" << std::endl;
+    std::cout << "Length hash: build " << hashBuild << ", " << hashIndex.memoryBytes() / (1024 * 1024) << " MiB, "
+              << hashIndex.distinctLengths() << " distinct note lengths, "
+              << titleRelation.size() / (hashTimer.getPrintTime() / 1000.0) << " lookups/s" << std::endl;
+
+    auto result = performJoin(castRelation, titleRelation, 8, PrefixJoinEngine::LengthHash);
+    std::sort(result.begin(), result.end());
+    EXPECT_TRUE(result == referenceJoin);
+}
+
+TEST_F(StringJoinTest, KeyFoldingThroughput) {
+    // Skalare Referenz über die Symboltabelle
+    size_t mismatches = 0;
+    const KeyColumn reference = foldTitles(titleRelation, 1);
+    for (size_t i = 0; i < titleRelation.size(); ++i) {
+        string_view title(titleRelation[i].title, strnlen(titleRelation[i].title, sizeof(titleRelation[i].title)));
+        string_view key = reference[i];
+        bool equal = key.size() == title.size();
+        for (size_t j = 0; equal && j < title.size(); ++j) {
+            equal = static_cast<uint8_t>(key[j]) == symbolOf(title[j]);
+        }
+        mismatches += !equal;
+    }
+    EXPECT_EQ(mismatches, 0u);
+
+    for (int numThreads : {1, 2, 4, 8}) {
+        Timer timer("Key folding");
+        timer.start();
+        const KeyColumn foldedNotes = foldNotes(castRelation, numThreads);
+        const KeyColumn foldedTitles = foldTitles(titleRelation, numThreads);
+        timer.pause();
+
+        const double megabytes =
+            static_cast<double>(foldedNotes.memoryBytes() + foldedTitles.memoryBytes()) / (1024 * 1024);
+        std::cout << "Key folding with " << numThreads << " threads: " << timer << ", "
+                  << megabytes / (timer.getPrintTime() / 1000.0) << " MiB/s of keys" << std::endl;
+    }
+}
+
+TEST_F(StringJoinTest, ProbeLoopAllocations) {
+    const Trie trie = buildTrie(castRelation, noteKeys, 8);
+
+    // Bisherige Variante: ein Trefferpuffer pro Titel, Ergebnisse in thread-lokalen Vektoren
+    vector<ResultRelation> vectorResults;
+    Timer vectorTimer("Probe with per-title vectors");
+    vectorTimer.start();
+    const size_t vectorAllocations = countAllocations([&] {
+        vector<vector<ResultRelation>> threadResults(8);
+        #pragma omp parallel num_threads(8)
+        {
+            vector<ResultRelation>& localResults = threadResults[omp_get_thread_num()];
+            #pragma omp for schedule(dynamic, 256)
+            for (size_t i = 0; i < titleRelation.size(); ++i) {
+                vector<const CastRelation*> prefixMatches;
+                prefixMatches.reserve(10);
+                trie.findPrefixMatches(titleKeys[i], prefixMatches);
+                for (const auto* cast : prefixMatches) {
+                    localResults.emplace_back(createResultTuple(*cast, titleRelation[i]));
+                }
             }
         }
+        for (auto& local : threadResults) {
+            vectorResults.insert(vectorResults.end(), local.begin(), local.end());
+        }
+    });
+    vectorTimer.pause();
+
+    probeTitles(trie, titleRelation, titleKeys, 8); // Aufwärmen des Thread-Pools
+    vector<ResultRelation> visitorResults;
+    Timer visitorTimer("Probe with visitor");
+    visitorTimer.start();
+    const size_t visitorAllocations = countAllocations([&] {
+        visitorResults = probeTitles(trie, titleRelation, titleKeys, 8);
+    });
+    visitorTimer.pause();
+
+    // Die Anzahl der Allokationen hängt nicht von der Anzahl der Titel ab: die halbe Titelrelation braucht
+    // genauso viele wie die ganze
+    const vector<TitleRelation> halfTitles(titleRelation.begin(), titleRelation.begin() + titleRelation.size() / 2);
+    const KeyColumn halfTitleKeys = foldTitles(halfTitles, 8);
+    const size_t halfAllocations = countAllocations([&] { probeTitles(trie, halfTitles, halfTitleKeys, 8); });
+    if (ALLOCATIONS_COUNTED) {
+        EXPECT_EQ(halfAllocations, visitorAllocations);
+        EXPECT_LT(visitorAllocations, vectorAllocations);
     }
+    std::sort(vectorResults.begin(), vectorResults.end());
+    std::sort(visitorResults.begin(), visitorResults.end());
+    EXPECT_TRUE(vectorResults == visitorResults);
 
-    // Kombiniere alle lokalen Ergebnisse
-    size_t totalSize = 0;
-    for (auto& vec : threadResults) {
-        totalSize += vec.size();
+    std::cout << "Per-title vectors: " << vectorAllocations << " allocations, " << vectorTimer << std::endl;
+    std::cout << "Visitor:           " << visitorAllocations << " allocations, " << visitorTimer << std::endl;
+}
+
+// Ersetzt den angegebenen Anteil der Titel durch Kopien weniger, häufiger Titel (Remakes, "Pilot"-Episoden, ...)
+static vector<TitleRelation> withDuplicateTitles(const vector<TitleRelation>& titleRelation, double duplicateRatio) {
+    static constexpr size_t POPULAR_TITLES = 1000;
+    vector<TitleRelation> titles = titleRelation;
+    const size_t popular = min(POPULAR_TITLES, titles.size());
+    for (size_t i = popular; i < titles.size(); ++i) {
+        if ((i * 2654435761u) % 1000 < duplicateRatio * 1000) {
+            // Quadratische Auswahl: wenige Titel kommen sehr oft vor
+            const size_t source = (i % popular) * (i % popular) / popular;
+            memcpy(titles[i].title, titleRelation[source].title, sizeof(titles[i].title));
+        }
+    }
+    return titles;
+}
+
+TEST_F(StringJoinTest, DuplicateTitleDeduplication) {
+    const SortedPrefixIndex index = buildSortedPrefixIndex(castRelation, noteKeys, 8);
+
+    for (double duplicateRatio : {0.0, 0.25, 0.5, 0.9}) {
+        const auto titles = withDuplicateTitles(titleRelation, duplicateRatio);
+        const KeyColumn duplicateKeys = foldTitles(titles, 8);
+        const size_t distinctTitles = KeyGroups::build(duplicateKeys, 8).size();
+
+        Timer plainTimer("Probe every title");
+        plainTimer.start();
+        const auto expected = probeTitles(index, titles, duplicateKeys, 8);
+        plainTimer.pause();
+
+        Timer dedupTimer("Probe distinct titles");
+        dedupTimer.start();
+        const auto result = probeDistinctTitles(index, titles, duplicateKeys, 8);
+        dedupTimer.pause();
+        EXPECT_TRUE(result == expected);
+
+        std::cout << "Duplicate ratio " << duplicateRatio << " (" << distinctTitles << " distinct of " << titles.size()
+                  << "): every title " << plainTimer.getPrintTime() << " ms, distinct titles "
+                  << dedupTimer.getPrintTime() << " ms, " << result.size() << " results" << std::endl;
     }
-    globalResults.reserve(totalSize);
-    for (auto& vec : threadResults) {
-        move(vec.begin(), vec.end(), back_inserter(globalResults));
+
+    auto result = performJoin(castRelation, titleRelation, 8, PrefixJoinEngine::Trie, true);
+    std::sort(result.begin(), result.end());
+    EXPECT_TRUE(result == referenceJoin);
+}
+
+TEST_F(StringJoinTest, AggregateModesWithoutTuples) {
+    Timer joinTimer("Materialized join");
+    joinTimer.start();
+    const auto result = performJoin(castRelation, titleRelation, 8, PrefixJoinEngine::Trie);
+    joinTimer.pause();
+
+    for (PrefixJoinEngine engine : {PrefixJoinEngine::Trie, PrefixJoinEngine::CompactTrie, PrefixJoinEngine::RadixTrie,
+                                    PrefixJoinEngine::SortedNotes, PrefixJoinEngine::LengthHash,
+                                    PrefixJoinEngine::SortedTitles}) {
+        Timer countTimer("Count per title");
+        countTimer.start();
+        const auto counts = countPrefixMatches(castRelation, titleRelation, 8, engine);
+        countTimer.pause();
+
+        Timer totalTimer("Total count");
+        totalTimer.start();
+        const uint64_t total = totalPrefixMatches(castRelation, titleRelation, 8, engine);
+        totalTimer.pause();
+
+        Timer semiTimer("Semi join");
+        semiTimer.start();
+        const auto bitmap = semiJoinTitles(castRelation, titleRelation, 8, engine);
+        semiTimer.pause();
+
+        // Das Ergebnis ist nach Titeln geordnet, die Zählungen müssen die Läufe pro Titel genau treffen
+        size_t position = 0;
+        size_t mismatches = 0;
+        for (size_t i = 0; i < titleRelation.size(); ++i) {
+            for (uint32_t m = 0; m < counts[i]; ++m, ++position) {
+                mismatches += position >= result.size() || result[position].titleId != titleRelation[i].titleId;
+            }
+            mismatches += ((bitmap[i / 64] >> (i % 64)) & 1) != (counts[i] != 0);
+        }
+        EXPECT_EQ(mismatches, 0u);
+        EXPECT_EQ(position, result.size());
+        EXPECT_EQ(total, result.size());
+
+        std::cout << "Engine " << static_cast<int>(engine) << ": count per title " << countTimer.getPrintTime()
+                  << " ms, total " << totalTimer.getPrintTime() << " ms, semi join " << semiTimer.getPrintTime()
+                  << " ms (materialized join with Trie: " << joinTimer.getPrintTime() << " ms)" << std::endl;
     }
+}
 
-    return globalResults;
-}
\ No newline at end of file
+// Referenz für die Enthaltensein-Suche: ein Präfix-Lookup pro Position im Titel, doppelte Treffer entfernt
+template <typename Index>
+static size_t countByOffsetLookups(const Index& index, string_view key, NoteMatch match,
+                                   vector<const CastRelation*>& scratch) {
+    scratch.clear();
+    for (size_t offset = 0; offset <= key.size(); ++offset) {
+        const string_view rest = key.substr(offset);
+        index.visitPrefixMatches(rest, [&](const CastRelation* const* first, const CastRelation* const* last) {
+            for (; first != last; ++first) {
+                if (match == NoteMatch::Substring || strnlen((*first)->note, sizeof((*first)->note)) == rest.size()) {
+                    scratch.push_back(*first);
+                }
+            }
+        });
+    }
+    sort(scratch.begin(), scratch.end());
+    return unique(scratch.begin(), scratch.end()) - scratch.begin();
+}
+
+TEST_F(StringJoinTest, TitleBuildSideCrossover) {
+    // Beide Seiten werden getrennt verkleinert, damit der Wechsel der Aufbauseite in beide Richtungen sichtbar wird
+    vector<pair<size_t, size_t>> sizes;
+    for (size_t titles : {titleRelation.size(), size_t{30000}, size_t{10000}, size_t{3000}, size_t{1000}, size_t{100}}) {
+        sizes.emplace_back(castRelation.size(), min(titles, titleRelation.size()));
+    }
+    for (size_t casts : {size_t{100000}, size_t{30000}, size_t{10000}, size_t{1000}}) {
+        sizes.emplace_back(min(casts, castRelation.size()), titleRelation.size());
+    }
+
+    for (const auto& [castCount, titleCount] : sizes) {
+        const vector<CastRelation> casts(castRelation.begin(), castRelation.begin() + castCount);
+        const vector<TitleRelation> titles(titleRelation.begin(), titleRelation.begin() + titleCount);
+
+        Timer trieTimer("Notes as build side");
+        trieTimer.start();
+        auto expected = performJoin(casts, titles, 8, PrefixJoinEngine::Trie);
+        trieTimer.pause();
+
+        Timer titleTimer("Titles as build side");
+        titleTimer.start();
+        auto result = performJoin(casts, titles, 8, PrefixJoinEngine::SortedTitles);
+        titleTimer.pause();
+
+        std::sort(expected.begin(), expected.end());
+        std::sort(result.begin(), result.end());
+        EXPECT_TRUE(result == expected);
+
+        const PrefixJoinEngine chosen = chooseBuildSide(foldNotes(casts, 8), foldTitles(titles, 8));
+        std::cout << castCount << " notes, " << titleCount << " titles: notes as build side "
+                  << trieTimer.getPrintTime() << " ms, titles as build side " << titleTimer.getPrintTime()
+                  << " ms, adaptive picks " << (chosen == PrefixJoinEngine::SortedTitles ? "titles" : "notes")
+                  << std::endl;
+    }
+}
+
+TEST_F(StringJoinTest, ConcurrentTrieUpdatesUnderProbes) {
+    // Ausgangszustand ist die erste Hälfte, der Schreiber fügt die zweite Hälfte ein und löscht das erste Viertel
+    const size_t quarter = castRelation.size() / 4;
+    const size_t half = castRelation.size() / 2;
+    auto compactTrieOver = [&](size_t begin, size_t end) {
+        CompactTrie trie;
+        for (size_t i = begin; i < end; ++i) {
+            trie.insert(noteKeys[i], &castRelation[i]);
+        }
+        return trie;
+    };
+    // Jede Suche während der Änderungen muss zwischen dem beständigen Teil und der Vereinigung liegen
+    const CompactTrie stable = compactTrieOver(quarter, half);
+    const CompactTrie everything = compactTrieOver(0, castRelation.size());
+
+    ConcurrentTrie trie;
+    Timer loadTimer("Concurrent trie load");
+    loadTimer.start();
+    for (size_t i = 0; i < half; ++i) {
+        trie.insert(noteKeys[i], &castRelation[i]);
+    }
+    loadTimer.pause();
+
+    atomic<bool> writerDone{false};
+    atomic<size_t> probes{0};
+    atomic<size_t> outOfBounds{0};
+    Timer updateTimer("Concurrent trie updates");
+    #pragma omp parallel num_threads(4)
+    {
+        if (omp_get_thread_num() == 0) {
+            updateTimer.start();
+            for (size_t i = half; i < castRelation.size(); ++i) {
+                trie.insert(noteKeys[i], &castRelation[i]);
+                if (i - half < quarter) trie.erase(noteKeys[i - half], &castRelation[i - half]);
+            }
+            updateTimer.pause();
+            writerDone = true;
+        } else {
+            size_t localProbes = 0;
+            size_t localOutOfBounds = 0;
+            const size_t start = (omp_get_thread_num() * 7919) % titleKeys.size();
+            for (size_t i = start; !writerDone; i = (i + 1) % titleKeys.size()) {
+                const size_t matches = countMatches(trie, titleKeys[i]);
+                localOutOfBounds += matches < countMatches(stable, titleKeys[i]) ||
+                                    matches > countMatches(everything, titleKeys[i]);
+                ++localProbes;
+            }
+            probes += localProbes;
+            outOfBounds += localOutOfBounds;
+        }
+    }
+    EXPECT_EQ(outOfBounds, 0u);
+
+    trie.collect();
+    const size_t finalMatches = countLookups(trie, titleKeys);
+    EXPECT_EQ(finalMatches, countLookups(compactTrieOver(quarter, castRelation.size()), titleKeys));
+    EXPECT_EQ(trie.size(), castRelation.size() - quarter);
+
+    // Vergleich: kompletter Neuaufbau des Tries über den Endzustand
+    const vector<CastRelation> finalCast(castRelation.begin() + quarter, castRelation.end());
+    const KeyColumn finalKeys = foldNotes(finalCast, 8);
+    Timer rebuildTimer("Trie rebuild");
+    rebuildTimer.start();
+    const Trie rebuilt = buildTrie(finalCast, finalKeys, 8);
+    rebuildTimer.pause();
+    EXPECT_EQ(countLookups(rebuilt, titleKeys), finalMatches);
+
+    const size_t updates = (castRelation.size() - half) + quarter;
+    std::cout << "Concurrent trie: " << loadTimer.getPrintTime() * 1e6 / static_cast<double>(half)
+              << " ns per insert without readers, " << updates << " updates in " << updateTimer.getPrintTime() << " ms ("
+              << updateTimer.getPrintTime() * 1e6 / static_cast<double>(updates) << " ns per update) while "
+              << probes << " probes ran, full rebuild " << rebuildTimer.getPrintTime() << " ms, "
+              << trie.memoryBytes() / (1024 * 1024) << " MiB" << std::endl;
+}
+
+TEST_F(StringJoinTest, ConcurrentTrieEraseChecksKey) {
+    // Gefaltete Schlüssel: "a" ist Präfix von "ab", beide Pfade existieren
+    const string a(1, '\x01');
+    const string ab = a + '\x02';
+    const CastRelation casts[2] = {};
+    ConcurrentTrie trie;
+    trie.insert(ab, &casts[0]);
+    trie.insert(a, &casts[1]);
+
+    // Ein anderer, existierender Schlüssel darf weder eine fremde Liste ändern noch das Tupel entfernen
+    EXPECT_FALSE(trie.erase(a, &casts[0]));
+    EXPECT_FALSE(trie.erase(ab + '\x03', &casts[0]));
+    EXPECT_EQ(trie.size(), 2u);
+    trie.collect();
+    vector<const CastRelation*> matches;
+    trie.findPrefixMatches(ab, matches);
+    std::sort(matches.begin(), matches.end());
+    EXPECT_EQ(matches, (vector<const CastRelation*>{&casts[0], &casts[1]}));
+
+    EXPECT_TRUE(trie.erase(ab, &casts[0]));
+    trie.collect();
+    matches.clear();
+    trie.findPrefixMatches(ab, matches);
+    EXPECT_EQ(matches, vector<const CastRelation*>{&casts[1]});
+}
+
+TEST_F(StringJoinTest, AhoCorasickContainmentThroughput) {
+    Timer buildTimer("Aho-Corasick build");
+    buildTimer.start();
+    const AhoCorasick automaton = buildAhoCorasick(castRelation, noteKeys);
+    buildTimer.pause();
+    const RadixTrie radixTrie = buildRadixTrie(castRelation, noteKeys);
+
+    size_t titleBytes = 0;
+    for (size_t i = 0; i < titleKeys.size(); ++i) {
+        titleBytes += titleKeys[i].size();
+    }
+    const double megabytes = static_cast<double>(titleBytes) / (1024 * 1024);
+    std::cout << "Aho-Corasick: build " << buildTimer << ", " << automaton.stateCount() << " states, "
+              << automaton.memoryBytes() / (1024 * 1024) << " MiB" << std::endl;
+
+    for (NoteMatch match : {NoteMatch::Substring, NoteMatch::Suffix}) {
+        const char* name = match == NoteMatch::Substring ? "Substring" : "Suffix";
+        for (int numThreads : {1, 8}) {
+            vector<uint32_t> counts(titleRelation.size());
+            Timer scanTimer("Aho-Corasick scan");
+            scanTimer.start();
+            #pragma omp parallel num_threads(numThreads)
+            {
+                AhoCorasick::SeenKeys seen = automaton.newSeenKeys();
+                #pragma omp for schedule(dynamic, 256)
+                for (size_t i = 0; i < titleRelation.size(); ++i) {
+                    uint32_t count = 0;
+                    visitNotes(automaton, titleKeys[i], match, seen,
+                               [&](const CastRelation* const* first, const CastRelation* const* last) { count += last - first; });
+                    counts[i] = count;
+                }
+            }
+            scanTimer.pause();
+
+            vector<const CastRelation*> scratch;
+            size_t mismatches = 0;
+            Timer offsetTimer("Lookup per title offset");
+            offsetTimer.start();
+            for (size_t i = 0; i < titleRelation.size(); ++i) {
+                mismatches += countByOffsetLookups(radixTrie, titleKeys[i], match, scratch) != counts[i];
+            }
+            offsetTimer.pause();
+            EXPECT_EQ(mismatches, 0u);
+
+            std::cout << name << " with " << numThreads << " threads: "
+                      << megabytes / (scanTimer.getPrintTime() / 1000.0) << " MB/s of title text, "
+                      << "RadixTrie lookup per offset: " << megabytes / (offsetTimer.getPrintTime() / 1000.0)
+                      << " MB/s" << std::endl;
+        }
+    }
+
+    // Materialisiertes Ergebnis auf einem Ausschnitt der Titel
+    const vector<TitleRelation> someTitles(titleRelation.begin(), titleRelation.begin() + min<size_t>(5000, titleRelation.size()));
+    const auto result = performContainmentJoin(castRelation, someTitles, 8, NoteMatch::Substring);
+    const auto expected = totalPrefixMatches(castRelation, someTitles, 8, PrefixJoinEngine::Trie);
+    EXPECT_GE(result.size(), expected);
+    for (const auto& tuple : result) {
+        string_view title(tuple.title, strnlen(tuple.title, sizeof(tuple.title)));
+        string_view note(tuple.note, strnlen(tuple.note, sizeof(tuple.note)));
+        string foldedTitle(title.size(), 0), foldedNote(note.size(), 0);
+        foldSymbols(title.data(), title.size(), foldedTitle.data());
+        foldSymbols(note.data(), note.size(), foldedNote.data());
+        ASSERT_NE(foldedTitle.find(foldedNote), string::npos);
+    }
+}
+
+TEST_F(StringJoinTest, EqualityJoinAgainstStdHashMap) {
+    auto casts = castRelation;
+    // Jede fünfzigste Notiz übernimmt einen Titel in anderer Schreibweise, damit es Treffer gibt
+    for (size_t i = 0; i < casts.size(); i += 50) {
+        const TitleRelation& title = titleRelation[(i / 50 * 7919) % titleRelation.size()];
+        const size_t length = strnlen(title.title, sizeof(title.title));
+        if (length >= sizeof(casts[i].note)) continue;
+        for (size_t j = 0; j < length; ++j) {
+            casts[i].note[j] = static_cast<char>(toupper(static_cast<unsigned char>(title.title[j])));
+        }
+        casts[i].note[length] = '\0';
+    }
+
+    // Referenz: std::unordered_multimap über die gefalteten Titel
+    Timer stdTimer("std::unordered_multimap join");
+    stdTimer.start();
+    const KeyColumn castKeys = foldNotes(casts, 1);
+    const KeyColumn foldedTitles = foldTitles(titleRelation, 1);
+    unordered_multimap<string_view, uint32_t> titleMap;
+    titleMap.reserve(titleRelation.size());
+    for (size_t i = 0; i < titleRelation.size(); ++i) {
+        titleMap.emplace(foldedTitles[i], static_cast<uint32_t>(i));
+    }
+    vector<ResultRelation> expected;
+    for (size_t i = 0; i < casts.size(); ++i) {
+        const auto [first, last] = titleMap.equal_range(castKeys[i]);
+        for (auto it = first; it != last; ++it) {
+            expected.push_back(createResultTuple(casts[i], titleRelation[it->second]));
+        }
+    }
+    stdTimer.pause();
+    std::sort(expected.begin(), expected.end());
+
+    for (int numThreads : {1, 8}) {
+        StringHashTable table;
+        Timer buildTimer("String hash table build");
+        buildTimer.start();
+        table.build(foldedTitles, numThreads);
+        buildTimer.pause();
+
+        Timer joinTimer("Equality join");
+        joinTimer.start();
+        auto result = performEqualityJoin(casts, titleRelation, numThreads);
+        joinTimer.pause();
+        std::sort(result.begin(), result.end());
+        EXPECT_TRUE(result == expected);
+
+        std::cout << "Equality join with " << numThreads << " threads: table build " << buildTimer.getPrintTime()
+                  << " ms (" << table.memoryBytes() / (1024 * 1024) << " MiB), join " << joinTimer.getPrintTime()
+                  << " ms, std::unordered_multimap " << stdTimer.getPrintTime() << " ms, "
+                  << result.size() << " results" << std::endl;
+    }
+}
+
+// Klassische Edit-Distanz mit zwei Zeilen, Referenz für den bitparallelen Algorithmus
+static size_t editDistance(string_view lhs, string_view rhs) {
+    vector<size_t> previous(rhs.size() + 1), current(rhs.size() + 1);
+    for (size_t j = 0; j <= rhs.size(); ++j) previous[j] = j;
+    for (size_t i = 1; i <= lhs.size(); ++i) {
+        current[0] = i;
+        for (size_t j = 1; j <= rhs.size(); ++j) {
+            current[j] = min({previous[j] + 1, current[j - 1] + 1, previous[j - 1] + (lhs[i - 1] != rhs[j - 1])});
+        }
+        swap(previous, current);
+    }
+    return previous[rhs.size()];
+}
+
+TEST_F(StringJoinTest, SimilarityJoinPruningAndThroughput) {
+    auto casts = castRelation;
+    auto titles = titleRelation;
+    // Kurze Notizen liegen in Distanz 2 zu sehr vielen Titeln, ein Ausschnitt hält das Ergebnis im Speicher
+    titles.resize(min<size_t>(titles.size(), 10000));
+    // Jede hundertste Notiz ist ein Titel mit Tippfehlern, damit es Treffer in Distanz 1 und 2 gibt
+    for (size_t i = 0; i < casts.size(); i += 100) {
+        const TitleRelation& title = titles[(i / 100 * 7919) % titles.size()];
+        string typo(title.title, strnlen(title.title, sizeof(title.title)));
+        if (typo.size() < 4 || typo.size() >= sizeof(casts[i].note)) continue;
+        typo[typo.size() / 2] = '#';
+        if (i % 200 == 0) typo.erase(1, 1);
+        memcpy(casts[i].note, typo.c_str(), typo.size() + 1);
+    }
+    const KeyColumn castKeys = foldNotes(casts, 8);
+    const KeyColumn titleSliceKeys = foldTitles(titles, 8);
+
+    // Bitparallele Verifikation gegen die klassische Tabelle
+    EditDistancePattern pattern;
+    size_t verifyMismatches = 0;
+    for (size_t i = 0; i < 2000; ++i) {
+        const string_view note = castKeys[i * 7 % castKeys.size()];
+        const string_view title = titleSliceKeys[i * 13 % titleSliceKeys.size()];
+        pattern.prepare(note);
+        const size_t distance = editDistance(note, title);
+        for (uint32_t k : {0u, 1u, 2u, 5u, 20u}) {
+            verifyMismatches += pattern.withinDistance(title, k) != (distance <= k);
+        }
+    }
+    EXPECT_EQ(verifyMismatches, 0u);
+
+    for (uint32_t maxDistance : {1u, 2u}) {
+        for (uint32_t q : {2u, 3u}) {
+            Timer buildTimer("q-gram index build");
+            buildTimer.start();
+            const QGramIndex index = buildQGramIndex(titleSliceKeys, q, maxDistance);
+            buildTimer.pause();
+
+            SimilarityStats stats;
+            Timer joinTimer("Similarity join");
+            joinTimer.start();
+            const auto result = similarityJoin(index, casts, titles, castKeys, 8, stats);
+            joinTimer.pause();
+
+            // Brute Force auf einer Stichprobe verschiedener Notizen: jedes Paar wird verifiziert
+            const KeyGroups groups = KeyGroups::build(castKeys, 8);
+            QGramIndex::Scratch scratch = index.newScratch();
+            SimilarityStats sampleStats;
+            size_t sampleMismatches = 0;
+            size_t bruteForcePairs = 0;
+            Timer bruteTimer("Brute force");
+            for (size_t g = 0; g < groups.size(); g += max<size_t>(1, groups.size() / 200)) {
+                const string_view note = castKeys[groups.representative(g)];
+                vector<uint32_t> filtered;
+                index.visitSimilar(note, scratch, sampleStats, [&](uint32_t title) { filtered.push_back(title); });
+                sort(filtered.begin(), filtered.end());
+
+                bruteTimer.start();
+                vector<uint32_t> expected;
+                pattern.prepare(note);
+                for (uint32_t t = 0; t < titleSliceKeys.size(); ++t) {
+                    if (pattern.withinDistance(titleSliceKeys[t], maxDistance)) expected.push_back(t);
+                }
+                bruteTimer.pause();
+                bruteForcePairs += titleSliceKeys.size();
+                sampleMismatches += filtered != expected;
+            }
+            EXPECT_EQ(sampleMismatches, 0u);
+
+            const double pairs = static_cast<double>(stats.pairs);
+            std::cout << "k=" << maxDistance << " q=" << q << ": build " << buildTimer.getPrintTime() << " ms ("
+                      << index.memoryBytes() / (1024 * 1024) << " MiB), join " << joinTimer.getPrintTime() << " ms, "
+                      << result.size() << " results" << std::endl;
+            std::cout << "  pairs " << stats.pairs << ", length+prefix filter keeps " << 100.0 * stats.candidates / pairs
+                      << "%, count filter keeps " << 100.0 * stats.countSurvivors / pairs << "%, matches "
+                      << stats.matches << std::endl;
+            std::cout << "  filtered " << pairs / (joinTimer.getPrintTime() / 1000.0) << " pairs/s, brute force "
+                      << bruteForcePairs / (bruteTimer.getPrintTime() / 1000.0) << " pairs/s" << std::endl;
+        }
+    }
+}
+
+TEST_F(StringJoinTest, MappedCsvLoader) {
+    const string path = (filesystem::temp_directory_path() / "ppds_cast_loader_test.csv").string();
+    {
+        ofstream file(path, ios::binary);
+        file << "id,person_id,movie_id,person_role_id,note,nr_order,role_id\n";
+        file << "1,2,3,4,(voice),5,6\n";
+        file << "7,8,9,10,windows line,11,12\r\n";
+        file << "13,14,15\n";                    // zu wenige Felder
+        file << "16,17,18,19,note,20,21,22\n";   // zu viele Felder
+        file << "23,,25,26,,27,28\n";            // leere Felder
+        file << "29,30,31,32," << string(150, 'x') << ",33,34\n";
+        file << "35,36,37,38,last line,39,40";   // ohne Zeilenumbruch am Ende
+    }
+
+    const auto cast = loadCastRelation(path);
+    ASSERT_EQ(cast.size(), 5u);
+    EXPECT_EQ(cast[0].castInfoId, 1);
+    EXPECT_STREQ(cast[0].note, "(voice)");
+    EXPECT_EQ(cast[0].roleId, 6);
+    EXPECT_STREQ(cast[1].note, "windows line");
+    EXPECT_EQ(cast[1].roleId, 12);
+    EXPECT_EQ(cast[2].personId, 0);
+    EXPECT_EQ(cast[2].note[0], '\0');
+    EXPECT_EQ(cast[2].nrOrder, 27);
+    EXPECT_EQ(string_view(cast[3].note, sizeof(cast[3].note)), string(sizeof(cast[3].note), 'x'));
+    EXPECT_EQ(cast[3].nrOrder, 33);
+    EXPECT_STREQ(cast[4].note, "last line");
+    EXPECT_EQ(cast[4].roleId, 40);
+    EXPECT_EQ(loadCastRelation(path, 2).size(), 2u);
+
+    // Über mehrere Blöcke hinweg: die Reihenfolge der Datei und die Grenze müssen mitten in einem Block halten
+    {
+        ofstream file(path, ios::binary);
+        file << "id,person_id,movie_id,person_role_id,note,nr_order,role_id\n";
+        for (int i = 0; i < 60000; ++i) {
+            file << i << ",1,2,3,a note of some length " << i << ",4,5\n";
+        }
+    }
+    const auto many = loadCastRelation(path);
+    ASSERT_EQ(many.size(), 60000u);
+    size_t outOfOrder = 0;
+    for (size_t i = 0; i < many.size(); ++i) {
+        outOfOrder += many[i].castInfoId != static_cast<int32_t>(i);
+    }
+    EXPECT_EQ(outOfOrder, 0u);
+    const auto limited = loadCastRelation(path, 45678);
+    ASSERT_EQ(limited.size(), 45678u);
+    EXPECT_EQ(limited.back().castInfoId, 45677);
+    filesystem::remove(path);
+
+    for (const char* name : {"cast_info_uniform.csv", "title_info_uniform.csv"}) {
+        const string dataPath = DATA_DIRECTORY + std::string(name);
+        Timer timer("CSV load");
+        timer.start();
+        const size_t tuples = string_view(name).starts_with("cast") ? loadCastRelation(dataPath).size()
+                                                                     : loadTitleRelation(dataPath).size();
+        timer.pause();
+        const double megabytes = static_cast<double>(filesystem::file_size(dataPath)) / (1024 * 1024);
+        std::cout << name << ": " << tuples << " tuples in " << timer.getPrintTime() << " ms, "
+                  << megabytes / (timer.getPrintTime() / 1000.0) << " MiB/s" << std::endl;
+    }
+}
+
+TEST_F(StringJoinTest, QuotedCsvFields) {
+    const string path = (filesystem::temp_directory_path() / "ppds_quoted_loader_test.csv").string();
+    {
+        ofstream file(path, ios::binary);
+        file << "id,person_id,movie_id,person_role_id,note,nr_order,role_id\n";
+        file << "1,2,3,4,\"(voice, uncredited)\",5,6\n";
+        file << "7,8,9,10,\"say \"\"hello\"\"\",11,12\n";
+        file << "13,14,15,16,\"two\nlines\",17,18\n";
+        file << "\"19\",20,21,22,\"\",23,24\n";
+    }
+    const auto cast = loadCastRelation(path);
+    ASSERT_EQ(cast.size(), 4u);
+    EXPECT_STREQ(cast[0].note, "(voice, uncredited)");
+    EXPECT_EQ(cast[0].roleId, 6);
+    EXPECT_STREQ(cast[1].note, "say \"hello\"");
+    EXPECT_STREQ(cast[2].note, "two\nlines");
+    EXPECT_EQ(cast[2].roleId, 18);
+    EXPECT_EQ(cast[3].castInfoId, 19);
+    EXPECT_EQ(cast[3].note[0], '\0');
+
+    // Zeilenumbrüche und Kommas in Anführungszeichen über die Grenzen der Dateistücke hinweg
+    {
+        ofstream file(path, ios::binary);
+        file << "id,person_id,movie_id,person_role_id,note,nr_order,role_id\n";
+        for (int i = 0; i < 60000; ++i) {
+            file << i << ",1,2,3,\"note " << i << ",\n\"\"quoted\"\"\n" << string(i % 7, ',') << "\",4," << i << "\n";
+        }
+    }
+    const auto many = loadCastRelation(path);
+    ASSERT_EQ(many.size(), 60000u);
+    size_t mismatches = 0;
+    for (size_t i = 0; i < many.size(); ++i) {
+        const string expected = "note " + to_string(i) + ",\n\"quoted\"\n" + string(i % 7, ',');
+        mismatches += many[i].castInfoId != static_cast<int32_t>(i) || many[i].roleId != static_cast<int32_t>(i) ||
+                      expected != many[i].note;
+    }
+    EXPECT_EQ(mismatches, 0u);
+    filesystem::remove(path);
+
+    // Durchsatz des Strukturscanners allein, ohne Tupel zu schreiben
+    const string dataPath = DATA_DIRECTORY + std::string("cast_info_uniform.csv");
+    ifstream data(dataPath, ios::binary);
+    const string text((istreambuf_iterator<char>(data)), istreambuf_iterator<char>());
+    Timer scanTimer("CSV structure scan");
+    scanTimer.start();
+    size_t records = 0;
+    for (int repetition = 0; repetition < 10; ++repetition) {
+        records += countRecords(text.data(), text.data() + text.size());
+    }
+    scanTimer.pause();
+    EXPECT_EQ(records, 10 * (loadCastRelation(dataPath).size() + 1));
+    const double gigabytes = 10.0 * static_cast<double>(text.size()) / (1024.0 * 1024 * 1024);
+    std::cout << "CSV structure scan: " << gigabytes / (scanTimer.getPrintTime() / 1000.0) << " GiB/s" << std::endl;
+}
+
+TEST_F(StringJoinTest, FieldDecoderMicrobenchmark) {
+    const string dataPath = DATA_DIRECTORY + std::string("cast_info_uniform.csv");
+    ifstream data(dataPath, ios::binary);
+    const string text((istreambuf_iterator<char>(data)), istreambuf_iterator<char>());
+
+    // Felder der Cast-Datei ohne Kopfzeile: die Notiz ist Text, alle anderen Felder sind Zahlen
+    vector<string_view> numbers;
+    vector<string_view> notes;
+    size_t fieldIndex = 0;
+    const char* field = text.data() + text.find('\n') + 1;
+    scanDelimiters(field, text.data() + text.size(), false, [&](const char* delimiter, bool newline) {
+        (fieldIndex == 4 ? notes : numbers).emplace_back(field, delimiter - field);
+        fieldIndex = newline ? 0 : fieldIndex + 1;
+        field = delimiter + 1;
+        return true;
+    });
+
+    // Die SWAR-Dekodierung muss für alle Längen, Vorzeichen und fehlerhaften Eingaben mit from_chars übereinstimmen
+    vector<string> samples{"", "0", "7", "-5", "+5", "12a", "a12", "00000000", "99999999", "123456789", "2147483647",
+                           "2147483648", "-2147483648", "1234567", " 12", "12 ", "9:", "/1"};
+    for (uint32_t value = 1; value < 100000000; value = value * 7 + 3) {
+        samples.push_back(to_string(value));
+    }
+    // Mit lesbaren Bytes vor der Zahl wird das ganze Wort geladen, die fremden Bytes davor dürfen nicht zählen
+    size_t mismatches = 0;
+    auto check = [&](string_view sample, const char* readableBegin) {
+        int32_t expected = 0;
+        from_chars(sample.data(), sample.data() + sample.size(), expected);
+        mismatches += parseInt(sample.data(), sample.data() + sample.size()) != expected;
+        mismatches += parseInt(sample.data(), sample.data() + sample.size(), readableBegin) != expected;
+    };
+    for (const string& sample : samples) {
+        const string padded = "98765432," + sample;
+        check(string_view(padded).substr(9), padded.data());
+    }
+    for (string_view number : numbers) check(number, text.data());
+    EXPECT_EQ(mismatches, 0u);
+
+    // Die Blockkopie muss dieselbe Spalte wie die byteweise begrenzte Kopie ergeben
+    CastRelation blocks{};
+    CastRelation bounded{};
+    size_t differentNotes = 0;
+    for (string_view note : notes) {
+        assignText(blocks.note, sizeof(blocks.note), note.data(), note.data() + note.size(), text.data() + text.size());
+        assignText(bounded.note, sizeof(bounded.note), note.data(), note.data() + note.size());
+        differentNotes += memcmp(blocks.note, bounded.note, sizeof(blocks.note)) != 0;
+    }
+    EXPECT_EQ(differentNotes, 0u);
+
+    auto measure = [&](const char* name, const vector<string_view>& fields, auto&& decode) {
+        uint64_t sink = 0;
+        Timer timer(name);
+        timer.start();
+        for (int repetition = 0; repetition < 5; ++repetition) {
+            for (string_view value : fields) sink += decode(value);
+        }
+        timer.pause();
+        const double nanoseconds = timer.getPrintTime() * 1e6 / (5.0 * static_cast<double>(fields.size()));
+        std::cout << name << ": " << nanoseconds << " ns per field (checksum " << sink << ")" << std::endl;
+    };
+
+    measure("std::stoi on a string copy", numbers, [](string_view value) {
+        return static_cast<uint64_t>(value.empty() ? 0 : stoi(string(value)));
+    });
+    measure("std::from_chars", numbers, [](string_view value) {
+        int32_t result = 0;
+        from_chars(value.data(), value.data() + value.size(), result);
+        return static_cast<uint64_t>(result);
+    });
+    measure("SWAR parseInt", numbers, [](string_view value) {
+        return static_cast<uint64_t>(parseInt(value.data(), value.data() + value.size()));
+    });
+    measure("SWAR parseInt with one 8 byte load", numbers, [&](string_view value) {
+        return static_cast<uint64_t>(parseInt(value.data(), value.data() + value.size(), text.data()));
+    });
+
+    // Die alte Kopie las immer die volle Spaltenbreite, hier aus einem ausreichend großen Puffer
+    CastRelation target{};
+    measure("fixed-width copy of a string copy", notes, [&](string_view value) {
+        string copy(value);
+        copy.reserve(sizeof(target.note));
+        memcpy(target.note, copy.c_str(), sizeof(target.note));
+        return static_cast<uint64_t>(target.note[0]);
+    });
+    measure("bounded assignText", notes, [&](string_view value) {
+        assignText(target.note, sizeof(target.note), value.data(), value.data() + value.size());
+        return static_cast<uint64_t>(target.note[0]);
+    });
+    const char* textEnd = text.data() + text.size();
+    measure("assignText in vector blocks", notes, [&](string_view value) {
+        assignText(target.note, sizeof(target.note), value.data(), value.data() + value.size(), textEnd);
+        return static_cast<uint64_t>(target.note[0]);
+    });
+}
+
+TEST_F(StringJoinTest, RelationSnapshots) {
+    const filesystem::path directory = filesystem::temp_directory_path() / "ppds_snapshot_test";
+    filesystem::create_directories(directory);
+    const string castPath = (directory / "cast_info_uniform.csv").string();
+    const string titlePath = (directory / "title_info_uniform.csv").string();
+    filesystem::copy_file(DATA_DIRECTORY + std::string("cast_info_uniform.csv"), castPath,
+                          filesystem::copy_options::overwrite_existing);
+    filesystem::copy_file(DATA_DIRECTORY + std::string("title_info_uniform.csv"), titlePath,
+                          filesystem::copy_options::overwrite_existing);
+    filesystem::remove(snapshotPath(castPath));
+    filesystem::remove(snapshotPath(titlePath));
+
+    Timer csvTimer("CSV load");
+    csvTimer.start();
+    const auto castCsv = loadCastRelation(castPath);
+    const auto titleCsv = loadTitleRelation(titlePath);
+    csvTimer.pause();
+    ASSERT_TRUE(createCastSnapshot(castPath));
+    ASSERT_TRUE(createTitleSnapshot(titlePath));
+
+    // Der Snapshot muss byteweise dieselben Tupel liefern wie das Parsen der CSV-Datei
+    Timer snapshotTimer("snapshot load");
+    snapshotTimer.start();
+    const auto castSnapshot = loadCastRelation(castPath);
+    const auto titleSnapshot = loadTitleRelation(titlePath);
+    snapshotTimer.pause();
+    ASSERT_EQ(castSnapshot.size(), castCsv.size());
+    ASSERT_EQ(titleSnapshot.size(), titleCsv.size());
+    EXPECT_EQ(memcmp(castSnapshot.data(), castCsv.data(), castCsv.size() * sizeof(CastRelation)), 0);
+    EXPECT_EQ(memcmp(titleSnapshot.data(), titleCsv.data(), titleCsv.size() * sizeof(TitleRelation)), 0);
+    const auto limited = loadCastRelation(castPath, 70000);
+    ASSERT_EQ(limited.size(), 70000u);
+    EXPECT_EQ(memcmp(limited.data(), castCsv.data(), limited.size() * sizeof(CastRelation)), 0);
+    std::cout << "CSV load: " << csvTimer.getPrintTime() << " ms, snapshot load: " << snapshotTimer.getPrintTime()
+              << " ms for " << castCsv.size() + titleCsv.size() << " tuples" << std::endl;
+
+    // Zonen: movieId (Spalte 2) als Wertebereich, note (Spalte 4) als Längenbereich je Block
+    {
+        SnapshotFile<CastRelation> snapshot;
+        ASSERT_TRUE(snapshot.open(snapshotPath(castPath)));
+        EXPECT_TRUE(snapshot.freshFor(castPath));
+        ASSERT_EQ(snapshot.tuples(), castCsv.size());
+        size_t wrongZones = 0;
+        for (size_t block = 0; block < snapshot.blocks(); ++block) {
+            const size_t first = block * SNAPSHOT_BLOCK_TUPLES;
+            const size_t last = min(castCsv.size(), first + SNAPSHOT_BLOCK_TUPLES);
+            int32_t minMovie = INT32_MAX, maxMovie = INT32_MIN, minLength = INT32_MAX, maxLength = INT32_MIN;
+            for (size_t i = first; i < last; ++i) {
+                minMovie = min(minMovie, castCsv[i].movieId);
+                maxMovie = max(maxMovie, castCsv[i].movieId);
+                const auto length = static_cast<int32_t>(strnlen(castCsv[i].note, sizeof(castCsv[i].note)));
+                minLength = min(minLength, length);
+                maxLength = max(maxLength, length);
+            }
+            wrongZones += snapshot.zone(2, block).min != minMovie || snapshot.zone(2, block).max != maxMovie;
+            wrongZones += snapshot.zone(4, block).min != minLength || snapshot.zone(4, block).max != maxLength;
+        }
+        EXPECT_EQ(wrongZones, 0u);
+    }
+
+    // Ein beschädigter Block wird erkannt, geladen wird dann aus der CSV-Datei
+    {
+        SnapshotFile<CastRelation> snapshot;
+        ASSERT_TRUE(snapshot.open(snapshotPath(castPath)));
+        const uint64_t noteOffset = snapshot.column(4).dataOffset;
+        snapshot.close();
+        fstream file(snapshotPath(castPath), ios::binary | ios::in | ios::out);
+        file.seekp(static_cast<streamoff>(noteOffset + 123456));
+        file.put('#');
+    }
+    vector<CastRelation> damaged;
+    EXPECT_FALSE(loadSnapshot(castPath, SIZE_MAX, damaged));
+    EXPECT_TRUE(damaged.empty());
+    EXPECT_EQ(loadCastRelation(castPath).size(), castCsv.size());
+
+    // Eine geänderte CSV-Datei macht den Snapshot ungültig
+    filesystem::last_write_time(titlePath, filesystem::last_write_time(titlePath) + chrono::seconds(1));
+    vector<TitleRelation> stale;
+    EXPECT_FALSE(loadSnapshot(titlePath, SIZE_MAX, stale));
+    ASSERT_TRUE(createTitleSnapshot(titlePath));
+    EXPECT_TRUE(loadSnapshot(titlePath, SIZE_MAX, stale));
+    EXPECT_EQ(stale.size(), titleCsv.size());
+
+    filesystem::remove_all(directory);
+}
+
+TEST_F(StringJoinTest, HeapRelationsAgainstFixedWidth) {
+    const auto heapCast = toHeapRelation(castRelation);
+    const auto heapTitle = toHeapRelation(titleRelation);
+    reportMemorySaved("cast_info", castRelation, heapCast);
+    reportMemorySaved("title_info", titleRelation, heapTitle);
+
+    // Direkt in Heaps geladene Relationen gleichen den umgewandelten, auch wenn das Limit einen Block abschneidet
+    auto sameRelation = [](const auto& loaded, const auto& converted, auto&& sameTuple) {
+        if (loaded.size() != converted.size() || loaded.strings.size() != converted.strings.size()) return false;
+        for (size_t i = 0; i < loaded.size(); ++i) {
+            if (!sameTuple(loaded.tuples[i], converted.tuples[i])) return false;
+        }
+        return true;
+    };
+    auto sameCast = [&](const auto& loaded, const auto& converted) {
+        return sameRelation(loaded, converted, [&](const HeapCastRelation& l, const HeapCastRelation& c) {
+            return l.castInfoId == c.castInfoId && loaded.text(l.note) == converted.text(c.note);
+        });
+    };
+    auto sameTitle = [&](const auto& loaded, const auto& converted) {
+        return sameRelation(loaded, converted, [&](const HeapTitleRelation& l, const HeapTitleRelation& c) {
+            return l.titleId == c.titleId && loaded.text(l.title) == converted.text(c.title) &&
+                   loaded.text(l.seriesYears) == converted.text(c.seriesYears);
+        });
+    };
+    EXPECT_TRUE(sameCast(loadHeapCastRelation(DATA_DIRECTORY + std::string("cast_info_uniform.csv"), 1000000),
+                         heapCast));
+    EXPECT_TRUE(sameTitle(loadHeapTitleRelation(DATA_DIRECTORY + std::string("title_info_uniform.csv"), 1000000),
+                          heapTitle));
+    EXPECT_TRUE(sameCast(loadHeapCastRelation(DATA_DIRECTORY + std::string("cast_info_uniform.csv"), 123457),
+                         toHeapRelation(loadCastRelation(DATA_DIRECTORY + std::string("cast_info_uniform.csv"),
+                                                         123457))));
+
+    // Aus den Heaps gefaltete Schlüssel sind dieselben wie aus den Spalten fester Breite
+    const KeyColumn heapNoteKeys = foldNotes(heapCast, 8);
+    size_t differentKeys = 0;
+    for (size_t i = 0; i < noteKeys.size(); ++i) {
+        differentKeys += noteKeys[i] != heapNoteKeys[i];
+    }
+    EXPECT_EQ(differentKeys, 0u);
+
+    for (const PrefixJoinEngine engine : {PrefixJoinEngine::Trie, PrefixJoinEngine::CompactTrie,
+                                          PrefixJoinEngine::RadixTrie, PrefixJoinEngine::SortedNotes,
+                                          PrefixJoinEngine::LengthHash, PrefixJoinEngine::SortedTitles,
+                                          PrefixJoinEngine::ConcurrentTrie}) {
+        Timer timer("Prefix join on heap relations");
+        timer.start();
+        auto result = performJoin(heapCast, heapTitle, 8, engine);
+        timer.pause();
+        std::sort(result.begin(), result.end());
+        EXPECT_TRUE(result == referenceJoin) << "engine " << static_cast<int>(engine);
+        std::cout << "Engine " << static_cast<int>(engine) << ": " << timer << std::endl;
+    }
+
+    auto deduplicated = performJoin(heapCast, heapTitle, 8, PrefixJoinEngine::Trie, true);
+    std::sort(deduplicated.begin(), deduplicated.end());
+    EXPECT_TRUE(deduplicated == referenceJoin);
+}
+
+TEST_F(StringJoinTest, ColumnTablesAgainstStructs) {
+    const CastTable castTable = toColumnTable(castRelation);
+    const TitleTable titleTable = toColumnTable(titleRelation);
+
+    for (const PrefixJoinEngine engine : {PrefixJoinEngine::Trie, PrefixJoinEngine::RadixTrie,
+                                          PrefixJoinEngine::SortedTitles}) {
+        Timer structTimer("Prefix join on structs");
+        structTimer.start();
+        performJoin(castRelation, titleRelation, 8, engine);
+        structTimer.pause();
+
+        Timer tableTimer("Prefix join on column tables");
+        tableTimer.start();
+        auto result = performJoin(castTable, titleTable, 8, engine);
+        tableTimer.pause();
+        std::sort(result.begin(), result.end());
+        EXPECT_TRUE(result == referenceJoin) << "engine " << static_cast<int>(engine);
+        std::cout << "Engine " << static_cast<int>(engine) << ": structs " << structTimer << ", column tables "
+                  << tableTimer << std::endl;
+    }
+}
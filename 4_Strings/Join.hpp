@@ -16,6 +16,94 @@
 
 #include "JoinUtils.hpp"
 
+/**
+ * @brief index structure the notes of the cast relation are loaded into
+ */
+enum class PrefixJoinEngine {
+    Trie,
+    CompactTrie,
+    RadixTrie,
+    SortedNotes,
+    LengthHash,
+    SortedTitles,   // the titles are indexed and the notes are streamed against them
+    Adaptive,       // build side chosen from the cardinalities and average string lengths
+    ConcurrentTrie, // updatable in place while lookups run
+};
+
 std::vector<ResultRelation> performJoin(const std::vector<CastRelation>& leftRelation, const std::vector<TitleRelation>& rightRelation, int numThreads);
 
+std::vector<ResultRelation> performJoin(const std::vector<CastRelation>& leftRelation, const std::vector<TitleRelation>& rightRelation, int numThreads, PrefixJoinEngine engine);
+
+/**
+ * @brief with deduplicateTitles set, titles with equal normalized strings are
+ * probed once and the matches are fanned out to every title of the group; the
+ * flag has no effect when the titles are the build side
+ */
+std::vector<ResultRelation> performJoin(const std::vector<CastRelation>& leftRelation, const std::vector<TitleRelation>& rightRelation, int numThreads, PrefixJoinEngine engine, bool deduplicateTitles);
+
+/**
+ * @brief prefix join of relations whose strings live in a string heap; the keys
+ * are folded from the heaps and the result tuples are the same as for the
+ * fixed-width relations
+ */
+std::vector<ResultRelation> performJoin(const HeapRelation<HeapCastRelation>& leftRelation, const HeapRelation<HeapTitleRelation>& rightRelation, int numThreads);
+
+std::vector<ResultRelation> performJoin(const HeapRelation<HeapCastRelation>& leftRelation, const HeapRelation<HeapTitleRelation>& rightRelation, int numThreads, PrefixJoinEngine engine);
+
+std::vector<ResultRelation> performJoin(const HeapRelation<HeapCastRelation>& leftRelation, const HeapRelation<HeapTitleRelation>& rightRelation, int numThreads, PrefixJoinEngine engine, bool deduplicateTitles);
+
+/**
+ * @brief prefix join of column tables; only the note and title columns are
+ * read to build and probe the index, the other columns are gathered for the
+ * matches
+ */
+std::vector<ResultRelation> performJoin(const CastTable& leftRelation, const TitleTable& rightRelation, int numThreads);
+
+std::vector<ResultRelation> performJoin(const CastTable& leftRelation, const TitleTable& rightRelation, int numThreads, PrefixJoinEngine engine);
+
+std::vector<ResultRelation> performJoin(const CastTable& leftRelation, const TitleTable& rightRelation, int numThreads, PrefixJoinEngine engine, bool deduplicateTitles);
+
+/**
+ * @brief number of cast tuples whose note is a prefix of each title, without
+ * materializing result tuples
+ */
+std::vector<uint32_t> countPrefixMatches(const std::vector<CastRelation>& leftRelation, const std::vector<TitleRelation>& rightRelation, int numThreads, PrefixJoinEngine engine);
+
+/**
+ * @brief size of the join result, without materializing result tuples
+ */
+uint64_t totalPrefixMatches(const std::vector<CastRelation>& leftRelation, const std::vector<TitleRelation>& rightRelation, int numThreads, PrefixJoinEngine engine);
+
+/**
+ * @brief semi join: bit i of the returned bitmap is set if title i has at least one match
+ */
+std::vector<uint64_t> semiJoinTitles(const std::vector<CastRelation>& leftRelation, const std::vector<TitleRelation>& rightRelation, int numThreads, PrefixJoinEngine engine);
+
+/**
+ * @brief where a note has to occur in a title for the containment join
+ */
+enum class NoteMatch {
+    Substring,
+    Suffix,
+};
+
+/**
+ * @brief joins every title with the cast tuples whose note occurs in the title
+ * (Substring) or ends it (Suffix); a cast tuple is reported once per title even
+ * if its note occurs several times
+ */
+std::vector<ResultRelation> performContainmentJoin(const std::vector<CastRelation>& leftRelation, const std::vector<TitleRelation>& rightRelation, int numThreads, NoteMatch match);
+
+/**
+ * @brief joins every cast tuple with the titles whose normalized title equals
+ * its normalized note
+ */
+std::vector<ResultRelation> performEqualityJoin(const std::vector<CastRelation>& leftRelation, const std::vector<TitleRelation>& rightRelation, int numThreads);
+
+/**
+ * @brief joins every cast tuple with the titles whose normalized title is
+ * within maxDistance edit operations of its normalized note
+ */
+std::vector<ResultRelation> performSimilarityJoin(const std::vector<CastRelation>& leftRelation, const std::vector<TitleRelation>& rightRelation, int numThreads, uint32_t maxDistance);
+
 #endif // JOIN_HPP
\ No newline at end of file
@@ -15,12 +15,32 @@
 #ifndef JOINUTIL_HPP
 #define JOINUTIL_HPP
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cstdio>
 #include <cstring>
-#include <fstream>
 #include <sstream>
 #include <iostream>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 //==--------------------------------------------------------------------==//
 //==------------------ RELATION & RELATION UTILITY----------------------==//
 //==--------------------------------------------------------------------==//
@@ -183,119 +203,869 @@ static constexpr size_t NUM_FIELD_CAST_RELATION = 7;
       return oss.str();
     }
 
-    inline void assignValueFromString(TitleRelation& titleRelation, const std::string& value, const size_t fieldIndex) {
+    //==--------------------------------------------------------------------==//
+    //==--------------------- DATASET LOADING LOGIC ------------------------==//
+    //==--------------------------------------------------------------------==//
+
+    // Size of the pieces the mapped file is split into before they are aligned to record boundaries, each
+    // resulting chunk is parsed by one thread
+    static constexpr size_t LOAD_CHUNK_SIZE = size_t{1} << 20;
+
+    // Copies the first length bytes at source into the column and zeroes the rest with whole vector blocks,
+    // each lane keeps its source byte if it lies below length. Reads columnSize bytes at source, the last
+    // block overlaps the previous one if the column size is not a multiple of the block.
+    inline bool copyMasked(char* column, const size_t columnSize, const char* source, const size_t length) {
+    #if defined(__AVX2__)
+      constexpr size_t BLOCK = 32;
+      const __m256i lanes = _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19,
+                                             20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31);
+      auto copyBlock = [&](const size_t offset) {
+        const size_t kept = std::min(length - std::min(length, offset), BLOCK);
+        const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + offset));
+        const __m256i keep = _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(kept)), lanes);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(column + offset), _mm256_and_si256(bytes, keep));
+      };
+    #elif defined(__SSE2__)
+      constexpr size_t BLOCK = 16;
+      const __m128i lanes = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+      auto copyBlock = [&](const size_t offset) {
+        const size_t kept = std::min(length - std::min(length, offset), BLOCK);
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + offset));
+        const __m128i keep = _mm_cmpgt_epi8(_mm_set1_epi8(static_cast<char>(kept)), lanes);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(column + offset), _mm_and_si128(bytes, keep));
+      };
+    #endif
+    #if defined(__SSE2__)
+      if (columnSize < BLOCK) return false;
+      for (size_t offset = 0; offset + BLOCK <= columnSize; offset += BLOCK) {
+        copyBlock(offset);
+      }
+      if (columnSize % BLOCK != 0) copyBlock(columnSize - BLOCK);
+      return true;
+    #else
+      static_cast<void>(column);
+      static_cast<void>(columnSize);
+      static_cast<void>(source);
+      static_cast<void>(length);
+      return false;
+    #endif
+    }
+
+    // Text fields are copied up to the size of their column, the rest of the column is zero-filled. Quoted
+    // fields lose their surrounding quotes and every doubled quote inside stands for one quote. Unquoted fields
+    // are copied in vector blocks if the column is at least one block wide and columnSize bytes can be read
+    // from begin before readableEnd.
+    inline void assignText(char* column, const size_t columnSize, const char* begin, const char* end,
+                           const char* readableEnd = nullptr) {
+      size_t length = 0;
+      if (end - begin >= 2 && *begin == '"' && end[-1] == '"') {
+        for (const char* c = begin + 1; c < end - 1 && length < columnSize; ++c) {
+          column[length++] = *c;
+          if (*c == '"') ++c;
+        }
+      } else {
+        length = std::min(static_cast<size_t>(end - begin), columnSize);
+        if (readableEnd != nullptr && readableEnd - begin >= static_cast<ptrdiff_t>(columnSize) &&
+            copyMasked(column, columnSize, begin, length)) {
+          return;
+        }
+        std::memcpy(column, begin, length);
+      }
+      std::memset(column + length, 0, columnSize - length);
+    }
+
+    // Eight ASCII digits in one word, most significant digit first in memory, to their value: neighbouring
+    // digits are combined to pairs, pairs to quadruples and quadruples to the result by three multiplications
+    inline uint32_t parseEightDigits(uint64_t digits) {
+      digits -= 0x3030303030303030ULL;
+      digits = digits * 10 + (digits >> 8);
+      return static_cast<uint32_t>((((digits & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) +
+                                    (((digits >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32);
+    }
+
+    // Unsigned numbers of up to eight digits are decoded branch-free in one word, longer, signed or malformed
+    // ones by from_chars. Empty or malformed numbers are read as 0. If the eight bytes before end can be read,
+    // i.e. lie at or behind readableBegin, the word is loaded with one fixed-size read and the bytes in front
+    // of the number are replaced by '0', otherwise only the number's bytes are copied into the word.
+    inline int32_t parseInt(const char* begin, const char* end, const char* readableBegin = nullptr) {
+      if (end - begin >= 2 && *begin == '"' && end[-1] == '"') {
+        ++begin;
+        --end;
+      }
+      const size_t length = static_cast<size_t>(end - begin);
+      if (std::endian::native == std::endian::little && length - 1 < 8) {
+        uint64_t digits = 0x3030303030303030ULL;
+        if (readableBegin != nullptr && end - readableBegin >= 8) {
+          std::memcpy(&digits, end - 8, 8);
+          const uint64_t numberBytes = ~uint64_t{0} << (8 * (8 - length));
+          digits = (digits & numberBytes) | (0x3030303030303030ULL & ~numberBytes);
+        } else {
+          std::memcpy(reinterpret_cast<char*>(&digits) + (8 - length), begin, length);
+        }
+        const bool allDigits = (digits & 0xF0F0F0F0F0F0F0F0ULL) == 0x3030303030303030ULL &&
+                               ((digits + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) == 0x3030303030303030ULL;
+        if (allDigits) return static_cast<int32_t>(parseEightDigits(digits));
+      }
+      int32_t value = 0;
+      std::from_chars(begin, end, value);
+      return value;
+    }
+
+    // Stores field fieldIndex of a record; the field lies in [begin, end) and the bytes of
+    // [readableBegin, readableEnd) around it may be read by the decoders
+    inline void assignValue(TitleRelation& titleRelation, const char* begin, const char* end, const size_t fieldIndex,
+                            const char* readableBegin = nullptr, const char* readableEnd = nullptr) {
+      auto number = [&] { return parseInt(begin, end, readableBegin); };
+      auto text = [&](char* column, const size_t columnSize) {
+        assignText(column, columnSize, begin, end, readableEnd);
+      };
       switch (fieldIndex) {
-      case 0: titleRelation.titleId = std::stoi(value); break;
-      case 1: std::memcpy(titleRelation.title, value.c_str(), 200); break;
-      case 2: std::memcpy(titleRelation.imdbIndex, value.c_str(), 12); break;
-      case 3: titleRelation.kindId = std::stoi(value); break;
-      case 4: titleRelation.productionYear = std::stoi(value); break;
-      case 5: titleRelation.imdbId = std::stoi(value); break;
-      case 6: std::memcpy(titleRelation.phoneticCode, value.c_str(), 5); break;
-      case 7: titleRelation.episodeOfId = std::stoi(value); break;
-      case 8: titleRelation.seasonNr = std::stoi(value); break;
-      case 9: titleRelation.episodeNr = std::stoi(value); break;
-      case 10: std::memcpy(titleRelation.seriesYears, value.c_str(), 49); break;
-      case 11: std::memcpy(titleRelation.md5sum, value.c_str(), 32); break;
+      case 0: titleRelation.titleId = number(); break;
+      case 1: text(titleRelation.title, sizeof(titleRelation.title)); break;
+      case 2: text(titleRelation.imdbIndex, sizeof(titleRelation.imdbIndex)); break;
+      case 3: titleRelation.kindId = number(); break;
+      case 4: titleRelation.productionYear = number(); break;
+      case 5: titleRelation.imdbId = number(); break;
+      case 6: text(titleRelation.phoneticCode, sizeof(titleRelation.phoneticCode)); break;
+      case 7: titleRelation.episodeOfId = number(); break;
+      case 8: titleRelation.seasonNr = number(); break;
+      case 9: titleRelation.episodeNr = number(); break;
+      case 10: text(titleRelation.seriesYears, sizeof(titleRelation.seriesYears)); break;
+      case 11: text(titleRelation.md5sum, sizeof(titleRelation.md5sum)); break;
       default: break;
       }
     }
 
-    inline void assignValueFromString(CastRelation& castRelation, const std::string& value, const size_t fieldIndex) {
+    inline void assignValue(CastRelation& castRelation, const char* begin, const char* end, const size_t fieldIndex,
+                            const char* readableBegin = nullptr, const char* readableEnd = nullptr) {
+      auto number = [&] { return parseInt(begin, end, readableBegin); };
       switch (fieldIndex) {
-      case 0: castRelation.castInfoId = std::stoi(value); break;
-      case 1: castRelation.personId = std::stoi(value); break;
-      case 2: castRelation.movieId = std::stoi(value); break;
-      case 3: castRelation.personRoleId = std::stoi(value); break;
-      case 4: std::memcpy(castRelation.note, value.c_str(), 100); break;
-      case 5: castRelation.nrOrder = std::stoi(value); break;
-      case 6: castRelation.roleId = std::stoi(value); break;
+      case 0: castRelation.castInfoId = number(); break;
+      case 1: castRelation.personId = number(); break;
+      case 2: castRelation.movieId = number(); break;
+      case 3: castRelation.personRoleId = number(); break;
+      case 4: assignText(castRelation.note, sizeof(castRelation.note), begin, end, readableEnd); break;
+      case 5: castRelation.nrOrder = number(); break;
+      case 6: castRelation.roleId = number(); break;
       default: break;
       }
     }
 
+    template <typename Relation>
+    constexpr size_t numberOfFields() {
+      return std::is_same_v<Relation, TitleRelation> ? NUM_FIELDS_TITLE_RELATION : NUM_FIELD_CAST_RELATION;
+    }
+
     //==--------------------------------------------------------------------==//
-    //==--------------------- DATASET LOADING LOGIC ------------------------==//
+    //==------------------------ CSV STRUCTURE -----------------------------==//
     //==--------------------------------------------------------------------==//
 
-    inline bool parseLine(const std::string& line, TitleRelation& record) {
-      std::istringstream ss(line);
-      std::string field;
-      size_t fieldIndex = 0;
+    // Quotes, commas and newlines of a 64 byte block as bit masks, bit i stands for byte i
+    struct CsvBlock {
+      uint64_t quotes;
+      uint64_t commas;
+      uint64_t newlines;
+    };
 
-      while (std::getline(ss, field, ',')) {
-        if (fieldIndex >= NUM_FIELDS_TITLE_RELATION) {
-          std::cerr << "Error: Too many fields in CSV line" << std::endl;
-          return false;
+    inline CsvBlock classifyBlock(const char* block) {
+    #if defined(__AVX2__)
+      const __m256i quote = _mm256_set1_epi8('"');
+      const __m256i comma = _mm256_set1_epi8(',');
+      const __m256i newline = _mm256_set1_epi8('\n');
+      const __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+      const __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+      auto mask = [](const __m256i lowBytes, const __m256i highBytes, const __m256i pattern) {
+        const uint32_t lowBits = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lowBytes, pattern)));
+        const uint32_t highBits = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(highBytes, pattern)));
+        return uint64_t{lowBits} | (uint64_t{highBits} << 32);
+      };
+      return {mask(low, high, quote), mask(low, high, comma), mask(low, high, newline)};
+    #elif defined(__SSE2__)
+      CsvBlock masks{0, 0, 0};
+      for (int part = 0; part < 4; ++part) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * part));
+        auto mask = [&](const char c) {
+          const int bits = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(c)));
+          return static_cast<uint64_t>(static_cast<uint16_t>(bits)) << (16 * part);
+        };
+        masks.quotes |= mask('"');
+        masks.commas |= mask(',');
+        masks.newlines |= mask('\n');
+      }
+      return masks;
+    #else
+      CsvBlock masks{0, 0, 0};
+      for (int i = 0; i < 64; ++i) {
+        masks.quotes |= static_cast<uint64_t>(block[i] == '"') << i;
+        masks.commas |= static_cast<uint64_t>(block[i] == ',') << i;
+        masks.newlines |= static_cast<uint64_t>(block[i] == '\n') << i;
+      }
+      return masks;
+    #endif
+    }
+
+    // Bit i of the result is the XOR of the bits 0 to i, i.e. whether an odd number of quotes precedes byte i
+    inline uint64_t prefixXor(uint64_t bits) {
+    #if defined(__PCLMUL__)
+      return static_cast<uint64_t>(
+          _mm_cvtsi128_si64(_mm_clmulepi64_si128(_mm_set_epi64x(0, static_cast<int64_t>(bits)), _mm_set1_epi8(-1), 0)));
+    #else
+      for (int shift = 1; shift < 64; shift *= 2) {
+        bits ^= bits << shift;
+      }
+      return bits;
+    #endif
+    }
+
+    // Runs over [begin, end) 64 bytes at a time and calls visit(position, isNewline) for every comma and newline
+    // outside quotes until visit returns false. A quote opens or closes a quoted field, an escaped quote ("")
+    // closes and reopens it, so the prefix XOR over the quote bits marks exactly the quoted bytes. The quoted
+    // state is carried from block to block, inQuotes is the state at begin.
+    template <typename Visitor>
+    void scanDelimiters(const char* begin, const char* end, const bool inQuotes, Visitor&& visit) {
+      uint64_t carry = inQuotes ? ~uint64_t{0} : 0;
+      alignas(64) char tail[64];
+      const size_t size = static_cast<size_t>(end - begin);
+      for (size_t offset = 0; offset < size; offset += 64) {
+        const char* block = begin + offset;
+        if (size - offset < 64) {
+          std::memcpy(tail, block, size - offset);
+          std::memset(tail + (size - offset), 0, 64 - (size - offset));
+          block = tail;
+        }
+        const CsvBlock masks = classifyBlock(block);
+        const uint64_t quoted = prefixXor(masks.quotes) ^ carry;
+        carry = static_cast<uint64_t>(static_cast<int64_t>(quoted) >> 63);
+        for (uint64_t delimiters = (masks.commas | masks.newlines) & ~quoted; delimiters != 0;
+             delimiters &= delimiters - 1) {
+          const int bit = std::countr_zero(delimiters);
+          if (!visit(begin + offset + bit, ((masks.newlines >> bit) & 1) != 0)) return;
         }
-        assignValueFromString(record, field, fieldIndex);
-        fieldIndex++;
       }
+    }
 
-      if (fieldIndex != NUM_FIELDS_TITLE_RELATION) {
-        std::cerr << "Error: Too few fields in CSV line" << std::endl;
-        return false;
+    inline size_t countQuotes(const char* begin, const char* end) {
+      size_t quotes = 0;
+      alignas(64) char tail[64] = {};
+      const size_t size = static_cast<size_t>(end - begin);
+      size_t offset = 0;
+      for (; offset + 64 <= size; offset += 64) {
+        quotes += std::popcount(classifyBlock(begin + offset).quotes);
       }
+      std::memcpy(tail, begin + offset, size - offset);
+      return quotes + std::popcount(classifyBlock(tail).quotes);
+    }
 
-      return true;
+    // First byte after the first record separator at or behind begin, or end
+    inline const char* nextRecord(const char* begin, const char* end, const bool inQuotes) {
+      const char* next = end;
+      scanDelimiters(begin, end, inQuotes, [&](const char* delimiter, const bool newline) {
+        if (newline) next = delimiter + 1;
+        return !newline;
+      });
+      return next;
+    }
+
+    // Number of records the chunk holds, a last record without newline included
+    inline size_t countRecords(const char* begin, const char* end) {
+      size_t records = 0;
+      const char* recordBegin = begin;
+      scanDelimiters(begin, end, false, [&](const char* delimiter, const bool newline) {
+        if (newline) {
+          ++records;
+          recordBegin = delimiter + 1;
+        }
+        return true;
+      });
+      return records + (recordBegin < end);
     }
 
-    inline bool parseLine(const std::string& line, CastRelation& record) {
-      std::istringstream ss(line);
-      std::string field;
+    struct LoadError {
+      size_t tuplesBefore; // tuples of the chunk parsed before the failing line
+      std::string message;
+    };
+
+    // Parses the records of a chunk into the zero-initialized slots at out and returns the number of tuples;
+    // the slots of failed records stay unused at the end
+    template <typename Relation>
+    size_t parseChunk(const char* begin, const char* end, Relation* out, std::vector<LoadError>& errors) {
+      size_t tuples = 0;
       size_t fieldIndex = 0;
+      const char* record = begin;
+      const char* field = begin;
+      auto endField = [&](const char* fieldEnd) {
+        if (fieldIndex < numberOfFields<Relation>()) {
+          assignValue(out[tuples], field, fieldEnd, fieldIndex, begin, end);
+        }
+        ++fieldIndex;
+        field = fieldEnd + 1;
+      };
+      auto endRecord = [&](const char* recordEnd) {
+        if (recordEnd > field && recordEnd[-1] == '\r') --recordEnd;
+        endField(recordEnd);
+        if (fieldIndex == numberOfFields<Relation>()) {
+          ++tuples;
+        } else {
+          out[tuples] = Relation{};
+          const char* error = fieldIndex > numberOfFields<Relation>() ? "Error: Too many fields in CSV line"
+                                                                       : "Error: Too few fields in CSV line";
+          errors.push_back({tuples, std::string(error) + "\nError: Failed to parse line: " +
+                                        std::string(record, recordEnd)});
+        }
+        fieldIndex = 0;
+      };
+
+      scanDelimiters(begin, end, false, [&](const char* delimiter, const bool newline) {
+        if (newline) {
+          endRecord(delimiter);
+          record = field = delimiter + 1;
+        } else {
+          endField(delimiter);
+        }
+        return true;
+      });
+      if (record < end) endRecord(end);
+      return tuples;
+    }
+
+    //==--------------------------------------------------------------------==//
+    //==------------------------ BINARY SNAPSHOTS --------------------------==//
+    //==--------------------------------------------------------------------==//
+
+    // A snapshot stores a relation column by column next to its CSV file. The file starts with a header and
+    // one entry per column, followed by the zone maps and the column data. Every column holds the raw values
+    // of one struct member, aligned to SNAPSHOT_ALIGNMENT bytes. The tuples are cut into blocks of
+    // SNAPSHOT_BLOCK_TUPLES; each block has a zone per column with the checksum of the block's bytes and the
+    // smallest and largest value (integers) or length (text). The header remembers the size and modification
+    // time of the CSV file it was converted from, so a changed CSV file makes the snapshot stale.
+    static constexpr char SNAPSHOT_MAGIC[8] = {'P', 'P', 'D', 'S', 'C', 'O', 'L', '\0'};
+    static constexpr uint32_t SNAPSHOT_VERSION = 1;
+    static constexpr size_t SNAPSHOT_BLOCK_TUPLES = size_t{1} << 16;
+    static constexpr size_t SNAPSHOT_ALIGNMENT = 64;
+    static constexpr size_t SNAPSHOT_TILE_TUPLES = 512; // loader step, a multiple of 32 bytes for every column
+
+    struct SnapshotHeader {
+      char magic[8];
+      uint32_t version;
+      uint32_t columnCount;
+      uint64_t tupleCount;
+      uint64_t blockTuples;
+      uint64_t sourceSize;
+      int64_t sourceModified; // nanoseconds since the epoch
+      uint64_t checksum;      // of the header with this field set to 0 and of the column entries
+    };
+
+    struct SnapshotColumn {
+      uint64_t dataOffset; // file offset of the column values
+      uint64_t zoneOffset; // file offset of the column's zones, one per block
+      uint32_t width;      // bytes per value
+      uint32_t integer;    // 1 for int32_t members, 0 for text
+    };
+
+    struct SnapshotZone {
+      uint64_t checksum;
+      int32_t min;
+      int32_t max;
+    };
+
+    inline std::string snapshotPath(const std::string& filename) { return filename + ".snapshot"; }
+
+    // Four independent multiply-rotate lanes over 8 byte words. Data may be added in pieces as long as all
+    // pieces but the last are a multiple of 32 bytes long; the tail is padded with zeros and the total size is
+    // mixed into the value.
+    class SnapshotChecksum {
+    public:
+      SnapshotChecksum& add(const void* data, const size_t size) {
+        const auto* bytes = static_cast<const unsigned char*>(data);
+        size_t offset = 0;
+        for (; offset + 32 <= size; offset += 32) {
+          for (int lane = 0; lane < 4; ++lane) {
+            uint64_t word;
+            std::memcpy(&word, bytes + offset + 8 * lane, 8);
+            lanes[lane] = mix(lanes[lane], word);
+          }
+        }
+        for (int lane = 0; offset < size; offset += 8, ++lane) {
+          uint64_t word = 0;
+          std::memcpy(&word, bytes + offset, std::min<size_t>(8, size - offset));
+          lanes[lane] = mix(lanes[lane], word);
+        }
+        total += size;
+        return *this;
+      }
+
+      [[nodiscard]] uint64_t value() const {
+        uint64_t result = total;
+        for (const uint64_t lane : lanes) result = mix(result, lane);
+        return result;
+      }
+
+    private:
+      static constexpr uint64_t PRIME = 0x9E3779B97F4A7C15ULL;
+      uint64_t lanes[4] = {PRIME, PRIME * 3, PRIME * 5, PRIME * 7};
+      uint64_t total = 0;
+
+      static uint64_t mix(const uint64_t lane, const uint64_t word) { return std::rotl((lane ^ word) * PRIME, 31); }
+    };
+
+    inline uint64_t snapshotChecksum(const void* data, const size_t size) {
+      return SnapshotChecksum().add(data, size).value();
+    }
 
-      while (std::getline(ss, field, ',')) {
-        if (fieldIndex >= NUM_FIELD_CAST_RELATION) {
-          std::cerr << "Error: Too many fields in CSV line" << std::endl;
+    // The members stored as snapshot columns, in file order
+    template <typename Relation>
+    constexpr auto snapshotColumns() {
+      if constexpr (std::is_same_v<Relation, TitleRelation>) {
+        return std::make_tuple(&TitleRelation::titleId, &TitleRelation::title, &TitleRelation::imdbIndex,
+                               &TitleRelation::kindId, &TitleRelation::productionYear, &TitleRelation::imdbId,
+                               &TitleRelation::phoneticCode, &TitleRelation::episodeOfId, &TitleRelation::seasonNr,
+                               &TitleRelation::episodeNr, &TitleRelation::seriesYears, &TitleRelation::md5sum);
+      } else {
+        return std::make_tuple(&CastRelation::castInfoId, &CastRelation::personId, &CastRelation::movieId,
+                               &CastRelation::personRoleId, &CastRelation::note, &CastRelation::nrOrder,
+                               &CastRelation::roleId);
+      }
+    }
+
+    // Calls visit(member, columnIndex) for every snapshot column of Relation
+    template <typename Relation, typename Visitor>
+    void forEachSnapshotColumn(Visitor&& visit) {
+      std::apply([&](const auto... members) {
+        size_t column = 0;
+        (visit(members, column++), ...);
+      }, snapshotColumns<Relation>());
+    }
+
+    template <typename Relation, typename Member>
+    using SnapshotField = std::remove_cvref_t<decltype(std::declval<Relation&>().*std::declval<Member>())>;
+
+    inline int64_t modificationTime(const struct stat& fileStatus) {
+      return static_cast<int64_t>(fileStatus.st_mtim.tv_sec) * 1000000000 + fileStatus.st_mtim.tv_nsec;
+    }
+
+    /**
+     * @brief Read-only mapping of a snapshot file. open() checks the magic,
+     * the version, the header checksum, the column layout of Relation and that
+     * every column and zone map lies inside the file; the block checksums are
+     * left to the reader of the blocks.
+     */
+    template <typename Relation>
+    class SnapshotFile {
+    public:
+      static constexpr size_t COLUMNS = std::tuple_size_v<decltype(snapshotColumns<Relation>())>;
+
+      SnapshotFile() = default;
+      SnapshotFile(const SnapshotFile&) = delete;
+      SnapshotFile& operator=(const SnapshotFile&) = delete;
+      ~SnapshotFile() { close(); }
+
+      bool open(const std::string& path) {
+        close();
+        const int descriptor = ::open(path.c_str(), O_RDONLY);
+        if (descriptor < 0) return false;
+        struct stat fileStatus {};
+        if (fstat(descriptor, &fileStatus) == 0 && static_cast<size_t>(fileStatus.st_size) >= sizeof(SnapshotHeader)) {
+          size = static_cast<size_t>(fileStatus.st_size);
+          void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, descriptor, 0);
+          file = mapping == MAP_FAILED ? nullptr : static_cast<const char*>(mapping);
+        }
+        ::close(descriptor);
+        if (file != nullptr && valid()) return true;
+        close();
+        return false;
+      }
+
+      void close() {
+        if (file != nullptr) munmap(const_cast<char*>(file), size);
+        file = nullptr;
+        size = 0;
+      }
+
+      [[nodiscard]] const SnapshotHeader& header() const { return *reinterpret_cast<const SnapshotHeader*>(file); }
+
+      [[nodiscard]] size_t tuples() const { return header().tupleCount; }
+
+      [[nodiscard]] size_t blocks() const { return (tuples() + header().blockTuples - 1) / header().blockTuples; }
+
+      [[nodiscard]] const SnapshotColumn& column(const size_t column) const {
+        return reinterpret_cast<const SnapshotColumn*>(file + sizeof(SnapshotHeader))[column];
+      }
+
+      [[nodiscard]] const SnapshotZone& zone(const size_t column, const size_t block) const {
+        return reinterpret_cast<const SnapshotZone*>(file + this->column(column).zoneOffset)[block];
+      }
+
+      [[nodiscard]] const char* columnData(const size_t column) const { return file + this->column(column).dataOffset; }
+
+      // Whether the snapshot was converted from the CSV file as it is now
+      [[nodiscard]] bool freshFor(const std::string& filename) const {
+        struct stat fileStatus {};
+        return stat(filename.c_str(), &fileStatus) == 0 &&
+               header().sourceSize == static_cast<uint64_t>(fileStatus.st_size) &&
+               header().sourceModified == modificationTime(fileStatus);
+      }
+
+    private:
+      const char* file = nullptr;
+      size_t size = 0;
+
+      [[nodiscard]] bool valid() const {
+        const size_t tableEnd = sizeof(SnapshotHeader) + COLUMNS * sizeof(SnapshotColumn);
+        SnapshotHeader copy = header();
+        if (std::memcmp(copy.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 ||
+            copy.version != SNAPSHOT_VERSION || copy.columnCount != COLUMNS || copy.blockTuples == 0 ||
+            size < tableEnd) {
           return false;
         }
-        assignValueFromString(record, field, fieldIndex);
-        fieldIndex++;
+        copy.checksum = 0;
+        const uint64_t checksum = snapshotChecksum(&copy, sizeof(copy)) ^
+                                  snapshotChecksum(file + sizeof(SnapshotHeader), tableEnd - sizeof(SnapshotHeader));
+        if (checksum != header().checksum) return false;
+
+        bool layout = true;
+        forEachSnapshotColumn<Relation>([&](const auto member, const size_t index) {
+          using Field = SnapshotField<Relation, decltype(member)>;
+          const SnapshotColumn& entry = column(index);
+          layout = layout && entry.width == sizeof(Field) && entry.integer == std::is_integral_v<Field> &&
+                   entry.zoneOffset <= size && (size - entry.zoneOffset) / sizeof(SnapshotZone) >= blocks() &&
+                   entry.dataOffset <= size && (size - entry.dataOffset) / sizeof(Field) >= tuples();
+        });
+        return layout;
       }
+    };
+
+    // Smallest and largest value of a block of one column, text columns report the lengths of their values
+    template <typename Field>
+    std::pair<int32_t, int32_t> zoneRange(const Field* values, const size_t count) {
+      int32_t min = INT32_MAX;
+      int32_t max = INT32_MIN;
+      for (size_t i = 0; i < count; ++i) {
+        int32_t value;
+        if constexpr (std::is_integral_v<Field>) {
+          value = values[i];
+        } else {
+          value = static_cast<int32_t>(strnlen(values[i], sizeof(Field)));
+        }
+        min = std::min(min, value);
+        max = std::max(max, value);
+      }
+      return count == 0 ? std::pair<int32_t, int32_t>{0, 0} : std::pair{min, max};
+    }
+
+    // Reserves room for count tuples and asks for transparent huge pages before the memory is first touched,
+    // which saves most of the page faults of filling a large relation
+    template <typename Relation>
+    void reserveHugePages(std::vector<Relation>& relation, const size_t count) {
+      relation.reserve(count);
+    #if defined(MADV_HUGEPAGE)
+      constexpr uintptr_t HUGE_PAGE = uintptr_t{1} << 21;
+      const auto begin = (reinterpret_cast<uintptr_t>(relation.data()) + HUGE_PAGE - 1) & ~(HUGE_PAGE - 1);
+      const auto end = (reinterpret_cast<uintptr_t>(relation.data() + count)) & ~(HUGE_PAGE - 1);
+      if (begin < end) madvise(reinterpret_cast<void*>(begin), end - begin, MADV_HUGEPAGE);
+    #endif
+    }
+
+    // Copies the first numberOfTuples tuples of a fresh snapshot into relation. Blocks are transposed from
+    // columns to tuples in parallel and every block's checksum is verified on the way. Returns false, without
+    // touching relation, if there is no fresh snapshot or if it is damaged.
+    template <typename Relation>
+    bool loadSnapshot(const std::string& filename, const size_t numberOfTuples, std::vector<Relation>& relation) {
+      SnapshotFile<Relation> snapshot;
+      if (!snapshot.open(snapshotPath(filename))) return false;
+      if (!snapshot.freshFor(filename)) return false;
 
-      if (fieldIndex != NUM_FIELD_CAST_RELATION) {
-        std::cerr << "Error: Too few fields in CSV line" << std::endl;
+      const size_t tuples = std::min(numberOfTuples, snapshot.tuples());
+      const size_t blockTuples = snapshot.header().blockTuples;
+      const size_t blocks = (tuples + blockTuples - 1) / blockTuples;
+      std::vector<Relation> data;
+      reserveHugePages(data, tuples);
+      data.resize(tuples);
+      size_t damagedBlocks = 0;
+      #pragma omp parallel for schedule(dynamic, 1) reduction(+ : damagedBlocks)
+      for (size_t block = 0; block < blocks; ++block) {
+        const size_t first = block * blockTuples;
+        const size_t last = std::min(tuples, first + blockTuples);
+        const size_t stored = std::min(snapshot.tuples(), first + blockTuples);
+        // Tiles of a few hundred tuples keep the written tuples in cache while every column adds its values
+        SnapshotChecksum checksums[SnapshotFile<Relation>::COLUMNS];
+        for (size_t tile = first; tile < stored; tile += SNAPSHOT_TILE_TUPLES) {
+          const size_t tileEnd = std::min(stored, tile + SNAPSHOT_TILE_TUPLES);
+          forEachSnapshotColumn<Relation>([&](const auto member, const size_t column) {
+            using Field = SnapshotField<Relation, decltype(member)>;
+            const Field* values = reinterpret_cast<const Field*>(snapshot.columnData(column)) + tile;
+            checksums[column].add(values, (tileEnd - tile) * sizeof(Field));
+            for (size_t tuple = tile; tuple < std::min(tileEnd, last); ++tuple) {
+              std::memcpy(&(data[tuple].*member), &values[tuple - tile], sizeof(Field));
+            }
+          });
+        }
+        for (size_t column = 0; column < SnapshotFile<Relation>::COLUMNS; ++column) {
+          damagedBlocks += checksums[column].value() != snapshot.zone(column, block).checksum;
+        }
+      }
+      if (damagedBlocks != 0) {
+        std::cerr << "Warning: Snapshot " << snapshotPath(filename) << " is damaged, parsing the CSV file"
+                  << std::endl;
         return false;
       }
 
+      if (tuples == numberOfTuples) std::cout << "Loaded enough tuples. Returning now..." << std::endl;
+      std::cout << "Loaded " << tuples << " tuples from snapshot." << std::endl;
+      relation = std::move(data);
       return true;
     }
 
+    // A CSV file mapped into memory and cut into chunks of about LOAD_CHUNK_SIZE bytes. The quotes of every
+    // piece are counted in parallel, their parity tells whether a piece starts inside a quoted field, and each
+    // piece boundary is moved behind the next record separator, so every chunk holds whole records. The first
+    // record is the header and belongs to no chunk. Chunks can be parsed independently of each other.
+    class CsvChunks {
+    public:
+      explicit CsvChunks(const std::string& filename) {
+        const int descriptor = open(filename.c_str(), O_RDONLY);
+        struct stat fileStatus {};
+        if (descriptor < 0 || fstat(descriptor, &fileStatus) != 0) {
+          std::cerr << "Error: Failed to open file " << filename << std::endl;
+          exit(-1);
+        }
+        fileSize = static_cast<size_t>(fileStatus.st_size);
+        if (fileSize > 0) {
+          mapping = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, descriptor, 0);
+          if (mapping == MAP_FAILED) {
+            std::cerr << "Error: Failed to map file " << filename << std::endl;
+            exit(-1);
+          }
+          madvise(mapping, fileSize, MADV_SEQUENTIAL);
+        }
+        close(descriptor);
+
+        const char* file = static_cast<const char*>(mapping);
+        const char* fileEnd = file + fileSize;
+        const char* body = fileSize > 0 ? nextRecord(file, fileEnd, false) : fileEnd;
+        const size_t bodySize = static_cast<size_t>(fileEnd - body);
+        const size_t pieces = std::max<size_t>(1, (bodySize + LOAD_CHUNK_SIZE - 1) / LOAD_CHUNK_SIZE);
+        auto pieceBegin = [&](const size_t piece) { return body + std::min(piece * LOAD_CHUNK_SIZE, bodySize); };
+        std::vector<size_t> quotes(pieces);
+        #pragma omp parallel for schedule(static)
+        for (size_t piece = 0; piece < pieces; ++piece) {
+          quotes[piece] = countQuotes(pieceBegin(piece), pieceBegin(piece + 1));
+        }
+        bounds.assign(pieces + 1, fileEnd);
+        bounds[0] = body;
+        size_t quotesBefore = 0;
+        for (size_t piece = 1; piece < pieces; ++piece) {
+          quotesBefore += quotes[piece - 1];
+          quotes[piece - 1] = quotesBefore;
+        }
+        #pragma omp parallel for schedule(static)
+        for (size_t piece = 1; piece < pieces; ++piece) {
+          bounds[piece] = nextRecord(pieceBegin(piece), fileEnd, quotes[piece - 1] % 2 == 1);
+        }
+        for (size_t piece = 1; piece <= pieces; ++piece) {
+          bounds[piece] = std::max(bounds[piece], bounds[piece - 1]);
+        }
+      }
+
+      CsvChunks(const CsvChunks&) = delete;
+      CsvChunks& operator=(const CsvChunks&) = delete;
+
+      ~CsvChunks() {
+        if (mapping != nullptr) munmap(mapping, fileSize);
+      }
+
+      [[nodiscard]] size_t size() const { return bounds.size() - 1; }
+
+      [[nodiscard]] const char* begin(const size_t chunk) const { return bounds[chunk]; }
+
+      [[nodiscard]] const char* end(const size_t chunk) const { return bounds[chunk + 1]; }
+
+      [[nodiscard]] size_t records(const size_t chunk) const { return countRecords(begin(chunk), end(chunk)); }
+
+      // Replaces the content of out by the tuples of the chunk, records that fail to parse are reported and
+      // skipped
+      template <typename Relation>
+      void parse(const size_t chunk, std::vector<Relation>& out) const {
+        out.assign(records(chunk), Relation{});
+        std::vector<LoadError> errors;
+        out.resize(parseChunk(begin(chunk), end(chunk), out.data(), errors));
+        for (const LoadError& error : errors) std::cerr << error.message << std::endl;
+      }
+
+    private:
+      void* mapping = nullptr;
+      size_t fileSize = 0;
+      std::vector<const char*> bounds;
+    };
+
+    // The chunks of the file are processed in rounds, each round sized from the tuples per chunk seen so far,
+    // until numberOfTuples tuples are available. A round counts the records of its chunks, grows the result
+    // once and lets every chunk parse straight into its own slots.
     template <typename Relation>
-    std::vector<Relation> load(const std::string& filename, const size_t numberOfTuples = SIZE_MAX) {
+    std::vector<Relation> loadCsv(const std::string& filename, const size_t numberOfTuples = SIZE_MAX) {
+      const CsvChunks file(filename);
+      const size_t chunks = file.size();
+      const size_t threads = std::max(1u, std::thread::hardware_concurrency());
       std::vector<Relation> data;
-      std::ifstream file(filename);
-      if (!file.is_open()) {
-        std::cerr << "Error: Failed to open file " << filename << std::endl;
-        exit(-1);
-      }
+      std::vector<size_t> chunkBegin(chunks + 1);
+      std::vector<size_t> chunkTuples(chunks);
+      std::vector<std::vector<LoadError>> chunkErrors(chunks);
+      size_t roundSize = numberOfTuples == SIZE_MAX ? chunks : threads;
+      for (size_t first = 0; first < chunks && data.size() < numberOfTuples; first += roundSize) {
+        if (first > 0) {
+          const size_t tuplesPerChunk = std::max<size_t>(1, data.size() / first);
+          roundSize = std::max(threads, (numberOfTuples - data.size() + tuplesPerChunk - 1) / tuplesPerChunk);
+        }
+        const size_t last = std::min(chunks, first + roundSize);
 
-      std::string line;
-      bool firstLine = true;
-      while (std::getline(file, line)) {
-        if (firstLine) {
-          firstLine = false;
-          continue;
+        #pragma omp parallel for schedule(static)
+        for (size_t chunk = first; chunk < last; ++chunk) {
+          chunkBegin[chunk + 1] = file.records(chunk);
         }
-        Relation record;
-        if (parseLine(line, record)) {
-          data.emplace_back(record);
-        } else {
-          std::cerr << "Error: Failed to parse line: " << line << std::endl;
+        const size_t roundBegin = data.size();
+        chunkBegin[first] = roundBegin;
+        for (size_t chunk = first; chunk < last; ++chunk) {
+          chunkBegin[chunk + 1] += chunkBegin[chunk];
+        }
+        data.resize(chunkBegin[last]);
+
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (size_t chunk = first; chunk < last; ++chunk) {
+          chunkTuples[chunk] = parseChunk(file.begin(chunk), file.end(chunk), data.data() + chunkBegin[chunk],
+                                          chunkErrors[chunk]);
         }
 
-        if (data.size() >= numberOfTuples) {
-          std::cout << "Loaded enough tuples. Returning now..." << std::endl;
-          break;
+        // Close the gaps left by records that failed to parse
+        size_t tuples = roundBegin;
+        for (size_t chunk = first; chunk < last; ++chunk) {
+          if (chunkBegin[chunk] != tuples) {
+            std::copy(data.begin() + chunkBegin[chunk], data.begin() + chunkBegin[chunk] + chunkTuples[chunk],
+                      data.begin() + tuples);
+          }
+          for (const LoadError& error : chunkErrors[chunk]) {
+            if (tuples + error.tuplesBefore < numberOfTuples) std::cerr << error.message << std::endl;
+          }
+          tuples += chunkTuples[chunk];
         }
+        data.resize(tuples);
+      }
+
+      // Records behind the limit are dropped as if they had never been read
+      if (data.size() >= numberOfTuples) {
+        data.resize(numberOfTuples);
+        std::cout << "Loaded enough tuples. Returning now..." << std::endl;
       }
 
-      file.close();
       std::cout << "Loaded " << data.size() << " tuples from file." << std::endl;
       return data;
     }
 
+    // Writes relation as the snapshot of the CSV file filename, whose status was taken before it was parsed.
+    // The snapshot is written to a temporary file that replaces the old snapshot only once it is complete.
+    template <typename Relation>
+    bool writeSnapshot(const std::vector<Relation>& relation, const std::string& filename,
+                       const struct stat& sourceStatus) {
+      constexpr size_t COLUMNS = SnapshotFile<Relation>::COLUMNS;
+      const size_t tuples = relation.size();
+      const size_t blocks = (tuples + SNAPSHOT_BLOCK_TUPLES - 1) / SNAPSHOT_BLOCK_TUPLES;
+      auto align = [](const size_t offset) { return (offset + SNAPSHOT_ALIGNMENT - 1) & ~(SNAPSHOT_ALIGNMENT - 1); };
+
+      SnapshotHeader header{};
+      std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+      header.version = SNAPSHOT_VERSION;
+      header.columnCount = COLUMNS;
+      header.tupleCount = tuples;
+      header.blockTuples = SNAPSHOT_BLOCK_TUPLES;
+      header.sourceSize = static_cast<uint64_t>(sourceStatus.st_size);
+      header.sourceModified = modificationTime(sourceStatus);
+
+      // Zone maps follow the column entries, the column data follows the zone maps
+      std::vector<SnapshotColumn> columns(COLUMNS);
+      std::vector<std::vector<SnapshotZone>> zones(COLUMNS, std::vector<SnapshotZone>(blocks));
+      size_t offset = align(sizeof(SnapshotHeader) + COLUMNS * sizeof(SnapshotColumn));
+      for (size_t column = 0; column < COLUMNS; ++column) {
+        columns[column].zoneOffset = offset;
+        offset = align(offset + blocks * sizeof(SnapshotZone));
+      }
+      forEachSnapshotColumn<Relation>([&](const auto member, const size_t column) {
+        using Field = SnapshotField<Relation, decltype(member)>;
+        columns[column].dataOffset = offset;
+        columns[column].width = sizeof(Field);
+        columns[column].integer = std::is_integral_v<Field>;
+        offset = align(offset + tuples * sizeof(Field));
+      });
+      const size_t fileSize = offset;
+
+      const std::string path = snapshotPath(filename);
+      const std::string temporaryPath = path + ".tmp";
+      const int descriptor = ::open(temporaryPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+      if (descriptor < 0) return false;
+      void* mapping = MAP_FAILED;
+      if (ftruncate(descriptor, static_cast<off_t>(fileSize)) == 0) {
+        mapping = mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+      }
+      ::close(descriptor);
+      if (mapping == MAP_FAILED) {
+        unlink(temporaryPath.c_str());
+        return false;
+      }
+      char* file = static_cast<char*>(mapping);
+
+      #pragma omp parallel for schedule(dynamic, 1)
+      for (size_t block = 0; block < blocks; ++block) {
+        const size_t first = block * SNAPSHOT_BLOCK_TUPLES;
+        const size_t last = std::min(tuples, first + SNAPSHOT_BLOCK_TUPLES);
+        forEachSnapshotColumn<Relation>([&](const auto member, const size_t column) {
+          using Field = SnapshotField<Relation, decltype(member)>;
+          Field* values = reinterpret_cast<Field*>(file + columns[column].dataOffset) + first;
+          for (size_t tuple = first; tuple < last; ++tuple) {
+            std::memcpy(&values[tuple - first], &(relation[tuple].*member), sizeof(Field));
+          }
+          const auto [min, max] = zoneRange(values, last - first);
+          zones[column][block] = {snapshotChecksum(values, (last - first) * sizeof(Field)), min, max};
+        });
+      }
+      std::memcpy(file + sizeof(SnapshotHeader), columns.data(), COLUMNS * sizeof(SnapshotColumn));
+      for (size_t column = 0; column < COLUMNS; ++column) {
+        std::memcpy(file + columns[column].zoneOffset, zones[column].data(), blocks * sizeof(SnapshotZone));
+      }
+      header.checksum = snapshotChecksum(&header, sizeof(header)) ^
+                        snapshotChecksum(file + sizeof(SnapshotHeader), COLUMNS * sizeof(SnapshotColumn));
+      std::memcpy(file, &header, sizeof(header));
+
+      const bool written = msync(file, fileSize, MS_SYNC) == 0;
+      munmap(file, fileSize);
+      if (!written || rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        unlink(temporaryPath.c_str());
+        return false;
+      }
+      return true;
+    }
+
+    // Parses the CSV file and stores it as a snapshot next to it, later loads of the file map the snapshot
+    // as long as the CSV file is not changed
+    template <typename Relation>
+    bool createSnapshot(const std::string& filename) {
+      struct stat sourceStatus {};
+      if (stat(filename.c_str(), &sourceStatus) != 0) {
+        std::cerr << "Error: Failed to open file " << filename << std::endl;
+        return false;
+      }
+      const std::vector<Relation> relation = loadCsv<Relation>(filename);
+      if (!writeSnapshot(relation, filename, sourceStatus)) {
+        std::cerr << "Error: Failed to write snapshot " << snapshotPath(filename) << std::endl;
+        return false;
+      }
+      return true;
+    }
+
+    // A fresh and intact snapshot next to the CSV file is mapped instead of parsing the file
+    template <typename Relation>
+    std::vector<Relation> load(const std::string& filename, const size_t numberOfTuples = SIZE_MAX) {
+      std::vector<Relation> relation;
+      if (loadSnapshot(filename, numberOfTuples, relation)) return relation;
+      return loadCsv<Relation>(filename, numberOfTuples);
+    }
+
     inline std::vector<TitleRelation> loadTitleRelation(const std::string& filename, const size_t numberOfTuples = SIZE_MAX) {
       return load<TitleRelation>(filename, numberOfTuples);
     }
@@ -304,6 +1074,10 @@ static constexpr size_t NUM_FIELD_CAST_RELATION = 7;
       return load<CastRelation>(filename, numberOfTuples);
     }
 
+    inline bool createTitleSnapshot(const std::string& filename) { return createSnapshot<TitleRelation>(filename); }
+
+    inline bool createCastSnapshot(const std::string& filename) { return createSnapshot<CastRelation>(filename); }
+
     inline ResultRelation createResultTuple(const CastRelation& cast, const TitleRelation& title) {
       ResultRelation result;
       // Assign values from title to result
@@ -332,4 +1106,552 @@ static constexpr size_t NUM_FIELD_CAST_RELATION = 7;
       return result;
     }
 
+    //==--------------------------------------------------------------------==//
+    //==---------------------- STRING HEAP RELATIONS -----------------------==//
+    //==--------------------------------------------------------------------==//
+
+    /**
+     * @brief String of a heap relation in 16 bytes. Strings of up to
+     * INLINE_BYTES bytes are stored in the handle itself; longer ones keep
+     * their first four bytes in the handle, followed by the offset of the
+     * whole string in the string heap of their relation.
+     */
+    struct HeapString {
+      static constexpr uint32_t INLINE_BYTES = 12;
+
+      uint32_t length;
+      char bytes[INLINE_BYTES];
+
+      [[nodiscard]] bool isInline() const { return length <= INLINE_BYTES; }
+
+      [[nodiscard]] uint64_t offset() const {
+        uint64_t offset;
+        std::memcpy(&offset, bytes + 4, sizeof(offset));
+        return offset;
+      }
+
+      // Moves the bytes of a string that is not inline by shift positions in its heap
+      void moveBy(const uint64_t shift) {
+        if (isInline()) return;
+        const uint64_t moved = offset() + shift;
+        std::memcpy(bytes + 4, &moved, sizeof(moved));
+      }
+    };
+
+    /**
+     * @brief Contiguous storage of the long strings of one relation. Strings
+     * are stored back to back without terminator, a HeapString is only valid
+     * together with the heap that produced it.
+     */
+    class StringHeap {
+    public:
+      /**
+       * @brief handle of value, whose bytes go to offset if they do not fit
+       * into the handle; the heap must already hold offset + value.size() bytes
+       */
+      HeapString place(const std::string_view value, const uint64_t offset) {
+        HeapString string{static_cast<uint32_t>(value.size()), {}};
+        if (string.isInline()) {
+          std::memcpy(string.bytes, value.data(), value.size());
+        } else {
+          std::memcpy(string.bytes, value.data(), 4);
+          std::memcpy(string.bytes + 4, &offset, sizeof(offset));
+          std::memcpy(bytes.data() + offset, value.data(), value.size());
+        }
+        return string;
+      }
+
+      /**
+       * @brief copies the first size bytes of other to offset, the strings of
+       * other then have to be moved by offset
+       */
+      void place(const StringHeap& other, const size_t size, const uint64_t offset) {
+        std::memcpy(bytes.data() + offset, other.bytes.data(), size);
+      }
+
+      HeapString add(const std::string_view value) {
+        const size_t offset = bytes.size();
+        if (value.size() > HeapString::INLINE_BYTES) bytes.resize(offset + value.size());
+        return place(value, offset);
+      }
+
+      [[nodiscard]] std::string_view view(const HeapString& string) const {
+        return {string.isInline() ? string.bytes : bytes.data() + string.offset(), string.length};
+      }
+
+      void resize(const size_t size) { bytes.resize(size); }
+
+      [[nodiscard]] size_t size() const { return bytes.size(); }
+
+      [[nodiscard]] size_t memoryBytes() const { return bytes.capacity(); }
+
+      // Bytes of value that do not fit into its handle
+      static size_t heapBytes(const std::string_view value) {
+        return value.size() > HeapString::INLINE_BYTES ? value.size() : 0;
+      }
+
+    private:
+      std::vector<char> bytes;
+    };
+
+    // CastRelation with the note in the string heap, 40 instead of 128 bytes
+    struct HeapCastRelation {
+      int32_t castInfoId;
+      int32_t personId;
+      int32_t movieId;
+      int32_t personRoleId;
+      HeapString note;
+      int32_t nrOrder;
+      int32_t roleId;
+    };
+
+    // TitleRelation with the title and the series years in the string heap, the short columns stay inline
+    struct HeapTitleRelation {
+      int32_t titleId;
+      HeapString title;
+      char imdbIndex[12];
+      int32_t kindId;
+      int32_t productionYear;
+      int32_t imdbId;
+      char phoneticCode[5];
+      int32_t episodeOfId;
+      int32_t seasonNr;
+      int32_t episodeNr;
+      HeapString seriesYears;
+      char md5sum[32];
+    };
+
+    /**
+     * @brief Relation whose tuples refer to strings in one shared heap.
+     */
+    template <typename Tuple>
+    struct HeapRelation {
+      std::vector<Tuple> tuples;
+      StringHeap strings;
+
+      [[nodiscard]] size_t size() const { return tuples.size(); }
+
+      [[nodiscard]] std::string_view text(const HeapString& string) const { return strings.view(string); }
+
+      /**
+       * @brief bytes reserved by the tuples and the string heap
+       */
+      [[nodiscard]] size_t memoryBytes() const { return tuples.capacity() * sizeof(Tuple) + strings.memoryBytes(); }
+    };
+
+    template <size_t N>
+    std::string_view fixedText(const char (&column)[N]) {
+      return {column, strnlen(column, N)};
+    }
+
+    // Copies text into a fixed-width column, cut to the column and zero-filled behind it
+    inline void copyText(char* column, const size_t columnSize, const std::string_view text) {
+      const size_t length = std::min(text.size(), columnSize);
+      std::memcpy(column, text.data(), length);
+      std::memset(column + length, 0, columnSize - length);
+    }
+
+    // The heap tuple of a fixed tuple, store(text) returns the handle of a string column
+    template <typename Store>
+    HeapCastRelation toHeapTuple(const CastRelation& cast, Store&& store) {
+      return {cast.castInfoId, cast.personId, cast.movieId, cast.personRoleId, store(fixedText(cast.note)),
+              cast.nrOrder, cast.roleId};
+    }
+
+    template <typename Store>
+    HeapTitleRelation toHeapTuple(const TitleRelation& title, Store&& store) {
+      HeapTitleRelation tuple{};
+      tuple.titleId = title.titleId;
+      tuple.title = store(fixedText(title.title));
+      std::memcpy(tuple.imdbIndex, title.imdbIndex, sizeof(tuple.imdbIndex));
+      tuple.kindId = title.kindId;
+      tuple.productionYear = title.productionYear;
+      tuple.imdbId = title.imdbId;
+      std::memcpy(tuple.phoneticCode, title.phoneticCode, sizeof(tuple.phoneticCode));
+      tuple.episodeOfId = title.episodeOfId;
+      tuple.seasonNr = title.seasonNr;
+      tuple.episodeNr = title.episodeNr;
+      tuple.seriesYears = store(fixedText(title.seriesYears));
+      std::memcpy(tuple.md5sum, title.md5sum, sizeof(tuple.md5sum));
+      return tuple;
+    }
+
+    // Calls visit(string) for every string column of a heap tuple
+    template <typename Visitor>
+    void forEachHeapString(HeapCastRelation& cast, Visitor&& visit) {
+      visit(cast.note);
+    }
+
+    template <typename Visitor>
+    void forEachHeapString(HeapTitleRelation& title, Visitor&& visit) {
+      visit(title.title);
+      visit(title.seriesYears);
+    }
+
+    // Tuples converted by one task of toHeapRelation
+    static constexpr size_t HEAP_CONVERSION_TUPLES = size_t{1} << 14;
+
+    /**
+     * @brief converts a fixed-width relation in two parallel passes: the first
+     * sums the heap bytes of every run of tuples, the second writes the tuples
+     * and the strings of each run to its own part of the heap
+     */
+    template <typename Relation>
+    auto toHeapRelation(const std::vector<Relation>& relation) {
+      using Tuple = decltype(toHeapTuple(relation[0], [](std::string_view) { return HeapString{}; }));
+      HeapRelation<Tuple> heapRelation;
+      const size_t runs = (relation.size() + HEAP_CONVERSION_TUPLES - 1) / HEAP_CONVERSION_TUPLES;
+      auto runEnd = [&](const size_t run) { return std::min(relation.size(), (run + 1) * HEAP_CONVERSION_TUPLES); };
+
+      std::vector<size_t> runOffsets(runs + 1, 0);
+      #pragma omp parallel for schedule(static)
+      for (size_t run = 0; run < runs; ++run) {
+        size_t bytes = 0;
+        for (size_t i = run * HEAP_CONVERSION_TUPLES; i < runEnd(run); ++i) {
+          toHeapTuple(relation[i], [&](const std::string_view text) {
+            bytes += StringHeap::heapBytes(text);
+            return HeapString{};
+          });
+        }
+        runOffsets[run + 1] = bytes;
+      }
+      for (size_t run = 0; run < runs; ++run) {
+        runOffsets[run + 1] += runOffsets[run];
+      }
+
+      heapRelation.tuples.resize(relation.size());
+      heapRelation.strings.resize(runOffsets[runs]);
+      #pragma omp parallel for schedule(static)
+      for (size_t run = 0; run < runs; ++run) {
+        size_t offset = runOffsets[run];
+        for (size_t i = run * HEAP_CONVERSION_TUPLES; i < runEnd(run); ++i) {
+          heapRelation.tuples[i] = toHeapTuple(relation[i], [&](const std::string_view text) {
+            const HeapString string = heapRelation.strings.place(text, offset);
+            offset += StringHeap::heapBytes(text);
+            return string;
+          });
+        }
+      }
+      return heapRelation;
+    }
+
+    // Every thread parses one chunk at a time into its own fixed-width buffer and converts it into a heap
+    // relation of the chunk, so the fixed-width tuples of at most one chunk per thread exist at any time. The
+    // chunks are read in rounds like in loadCsv and concatenated at the end, the strings of every chunk are
+    // moved behind the heaps of the chunks before it.
+    template <typename Relation>
+    auto loadHeapCsv(const std::string& filename, const size_t numberOfTuples) {
+      using Tuple = decltype(toHeapTuple(Relation{}, [](std::string_view) { return HeapString{}; }));
+      const CsvChunks file(filename);
+      const size_t chunks = file.size();
+      const size_t threads = std::max(1u, std::thread::hardware_concurrency());
+      std::vector<HeapRelation<Tuple>> parts(chunks);
+      size_t tuples = 0;
+      size_t used = 0;
+      size_t roundSize = numberOfTuples == SIZE_MAX ? chunks : threads;
+      for (size_t first = 0; first < chunks && tuples < numberOfTuples; first += roundSize) {
+        if (first > 0) {
+          const size_t tuplesPerChunk = std::max<size_t>(1, tuples / first);
+          roundSize = std::max(threads, (numberOfTuples - tuples + tuplesPerChunk - 1) / tuplesPerChunk);
+        }
+        const size_t last = std::min(chunks, first + roundSize);
+        #pragma omp parallel
+        {
+          std::vector<Relation> buffer;
+          #pragma omp for schedule(dynamic, 1)
+          for (size_t chunk = first; chunk < last; ++chunk) {
+            file.parse(chunk, buffer);
+            parts[chunk] = toHeapRelation(buffer);
+          }
+        }
+        for (size_t chunk = first; chunk < last; ++chunk) {
+          tuples += parts[chunk].size();
+        }
+        used = last;
+      }
+
+      // Records behind the limit are dropped as if they had never been read, so is their part of the heap
+      std::vector<size_t> tupleBegin(used + 1, 0);
+      std::vector<size_t> heapBegin(used + 1, 0);
+      std::vector<size_t> heapSize(used, 0);
+      for (size_t chunk = 0; chunk < used; ++chunk) {
+        HeapRelation<Tuple>& part = parts[chunk];
+        const size_t kept = std::min(part.size(), std::min(tuples, numberOfTuples) - tupleBegin[chunk]);
+        heapSize[chunk] = part.strings.size();
+        if (kept < part.size()) {
+          heapSize[chunk] = 0;
+          for (size_t i = 0; i < kept; ++i) {
+            forEachHeapString(part.tuples[i], [&](const HeapString& string) {
+              if (!string.isInline()) heapSize[chunk] = string.offset() + string.length;
+            });
+          }
+        }
+        tupleBegin[chunk + 1] = tupleBegin[chunk] + kept;
+        heapBegin[chunk + 1] = heapBegin[chunk] + heapSize[chunk];
+      }
+
+      HeapRelation<Tuple> relation;
+      relation.tuples.resize(tupleBegin[used]);
+      relation.strings.resize(heapBegin[used]);
+      #pragma omp parallel for schedule(dynamic, 1)
+      for (size_t chunk = 0; chunk < used; ++chunk) {
+        HeapRelation<Tuple>& part = parts[chunk];
+        relation.strings.place(part.strings, heapSize[chunk], heapBegin[chunk]);
+        for (size_t i = 0; i < tupleBegin[chunk + 1] - tupleBegin[chunk]; ++i) {
+          Tuple& tuple = relation.tuples[tupleBegin[chunk] + i];
+          tuple = part.tuples[i];
+          forEachHeapString(tuple, [&](HeapString& string) { string.moveBy(heapBegin[chunk]); });
+        }
+        part = HeapRelation<Tuple>();
+      }
+
+      if (tuples >= numberOfTuples) std::cout << "Loaded enough tuples. Returning now..." << std::endl;
+      std::cout << "Loaded " << relation.size() << " tuples from file." << std::endl;
+      return relation;
+    }
+
+    // A snapshot is mapped into fixed-width tuples and converted, a CSV file is converted chunk by chunk
+    template <typename Relation>
+    auto loadHeap(const std::string& filename, const size_t numberOfTuples) {
+      std::vector<Relation> relation;
+      if (loadSnapshot(filename, numberOfTuples, relation)) return toHeapRelation(relation);
+      return loadHeapCsv<Relation>(filename, numberOfTuples);
+    }
+
+    inline HeapRelation<HeapTitleRelation> loadHeapTitleRelation(const std::string& filename,
+                                                                 const size_t numberOfTuples = SIZE_MAX) {
+      return loadHeap<TitleRelation>(filename, numberOfTuples);
+    }
+
+    inline HeapRelation<HeapCastRelation> loadHeapCastRelation(const std::string& filename,
+                                                               const size_t numberOfTuples = SIZE_MAX) {
+      return loadHeap<CastRelation>(filename, numberOfTuples);
+    }
+
+    inline ResultRelation createResultTuple(const HeapCastRelation& cast, const StringHeap& castStrings,
+                                            const HeapTitleRelation& title, const StringHeap& titleStrings) {
+      ResultRelation result;
+      result.titleId = title.titleId;
+      copyText(result.title, sizeof(result.title), titleStrings.view(title.title));
+      std::memcpy(result.imdbIndex, title.imdbIndex, sizeof(result.imdbIndex));
+      result.kindId = title.kindId;
+      result.productionYear = title.productionYear;
+      result.imdbId = title.imdbId;
+      std::memcpy(result.phoneticCode, title.phoneticCode, sizeof(result.phoneticCode));
+      result.episodeOfId = title.episodeOfId;
+      result.seasonNr = title.seasonNr;
+      result.episodeNr = title.episodeNr;
+      copyText(result.seriesYears, sizeof(result.seriesYears), titleStrings.view(title.seriesYears));
+      std::memcpy(result.md5sum, title.md5sum, sizeof(result.md5sum));
+
+      result.castInfoId = cast.castInfoId;
+      result.personId = cast.personId;
+      result.movieId = cast.movieId;
+      result.personRoleId = cast.personRoleId;
+      copyText(result.note, sizeof(result.note), castStrings.view(cast.note));
+      result.nrOrder = cast.nrOrder;
+      result.roleId = cast.roleId;
+
+      return result;
+    }
+
+    /**
+     * @brief memory of a fixed-width relation against its heap form, printed as
+     * one line of the form "name: fixed MiB -> heap MiB (saved %)"
+     */
+    template <typename Relation, typename Tuple>
+    void reportMemorySaved(const std::string& name, const std::vector<Relation>& relation,
+                           const HeapRelation<Tuple>& heapRelation) {
+      const double fixedBytes = static_cast<double>(relation.capacity() * sizeof(Relation));
+      const double heapBytes = static_cast<double>(heapRelation.memoryBytes());
+      const double mebibyte = 1024.0 * 1024.0;
+      std::cout << name << ": " << fixedBytes / mebibyte << " MiB -> " << heapBytes / mebibyte << " MiB (saved "
+                << (fixedBytes == 0 ? 0.0 : 100.0 * (1.0 - heapBytes / fixedBytes)) << " %)" << std::endl;
+    }
+
+    //==--------------------------------------------------------------------==//
+    //==------------------------ COLUMNAR TABLES ---------------------------==//
+    //==--------------------------------------------------------------------==//
+
+    // Every column of a ColumnTable starts on its own cache line
+    static constexpr size_t COLUMN_ALIGNMENT = 64;
+
+    template <typename T>
+    struct ColumnAllocator {
+      using value_type = T;
+
+      ColumnAllocator() = default;
+
+      template <typename U>
+      ColumnAllocator(const ColumnAllocator<U>&) {}
+
+      T* allocate(const size_t count) {
+        return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t{COLUMN_ALIGNMENT}));
+      }
+
+      void deallocate(T* values, size_t) { ::operator delete(values, std::align_val_t{COLUMN_ALIGNMENT}); }
+
+      template <typename U>
+      bool operator==(const ColumnAllocator<U>&) const { return true; }
+    };
+
+    template <typename T>
+    using AlignedColumn = std::vector<T, ColumnAllocator<T>>;
+
+    // Text columns store their char arrays as std::array, which a vector can hold
+    template <typename Field>
+    using ColumnValue = std::conditional_t<std::is_array_v<Field>,
+                                           std::array<std::remove_extent_t<Field>, std::extent_v<Field>>, Field>;
+
+    template <size_t N>
+    std::string_view fixedText(const std::array<char, N>& column) {
+      return {column.data(), strnlen(column.data(), N)};
+    }
+
+    template <typename Relation, typename Members = decltype(snapshotColumns<Relation>())>
+    struct TableColumns;
+
+    template <typename Relation, typename... Members>
+    struct TableColumns<Relation, std::tuple<Members...>> {
+      using type = std::tuple<AlignedColumn<ColumnValue<SnapshotField<Relation, Members>>>...>;
+    };
+
+    // The ResultRelation members the columns of Relation are gathered into, in column order
+    template <typename Relation>
+    constexpr auto resultColumns() {
+      if constexpr (std::is_same_v<Relation, TitleRelation>) {
+        return std::make_tuple(&ResultRelation::titleId, &ResultRelation::title, &ResultRelation::imdbIndex,
+                               &ResultRelation::kindId, &ResultRelation::productionYear, &ResultRelation::imdbId,
+                               &ResultRelation::phoneticCode, &ResultRelation::episodeOfId, &ResultRelation::seasonNr,
+                               &ResultRelation::episodeNr, &ResultRelation::seriesYears, &ResultRelation::md5sum);
+      } else {
+        return std::make_tuple(&ResultRelation::castInfoId, &ResultRelation::personId, &ResultRelation::movieId,
+                               &ResultRelation::personRoleId, &ResultRelation::note, &ResultRelation::nrOrder,
+                               &ResultRelation::roleId);
+      }
+    }
+
+    /**
+     * @brief Relation stored column by column (structure of arrays). The
+     * columns are the members of Relation in declaration order, the same as in
+     * a snapshot; the join key column is KEY_COLUMN. A scan of the keys reads 4
+     * bytes per tuple instead of the whole struct, the payload columns are only
+     * touched for the rows that are gathered.
+     */
+    template <typename Relation>
+    class ColumnTable {
+    public:
+      static constexpr size_t COLUMNS = std::tuple_size_v<decltype(snapshotColumns<Relation>())>;
+      static constexpr size_t KEY_COLUMN = std::is_same_v<Relation, TitleRelation> ? 0 : 2; // titleId, movieId
+
+      [[nodiscard]] size_t size() const { return std::get<0>(columns).size(); }
+
+      void resize(const size_t count) {
+        std::apply([&](auto&... column) { (column.resize(count), ...); }, columns);
+      }
+
+      template <size_t I>
+      [[nodiscard]] auto& column() { return std::get<I>(columns); }
+
+      template <size_t I>
+      [[nodiscard]] const auto& column() const { return std::get<I>(columns); }
+
+      [[nodiscard]] const AlignedColumn<int32_t>& keys() const { return std::get<KEY_COLUMN>(columns); }
+
+      // Writes the members of tuple to row
+      void set(const size_t row, const Relation& tuple) {
+        forEachColumn([&](auto& column, const auto member, auto) {
+          std::memcpy(&column[row], &(tuple.*member), sizeof(column[row]));
+        });
+      }
+
+      [[nodiscard]] Relation row(const size_t row) const {
+        Relation tuple;
+        forEachColumn([&](const auto& column, const auto member, auto) {
+          std::memcpy(&(tuple.*member), &column[row], sizeof(column[row]));
+        });
+        return tuple;
+      }
+
+      // Copies the columns of row into the matching members of result
+      void gather(const size_t row, ResultRelation& result) const {
+        forEachColumn([&](const auto& column, auto, const auto resultMember) {
+          static_assert(sizeof(column[row]) == sizeof(result.*resultMember));
+          std::memcpy(&(result.*resultMember), &column[row], sizeof(column[row]));
+        });
+      }
+
+      /**
+       * @brief bytes reserved by all columns
+       */
+      [[nodiscard]] size_t memoryBytes() const {
+        size_t bytes = 0;
+        std::apply([&](const auto&... column) { ((bytes += column.capacity() * sizeof(column[0])), ...); }, columns);
+        return bytes;
+      }
+
+    private:
+      typename TableColumns<Relation>::type columns;
+
+      // Calls visit(column, relationMember, resultMember) for every column
+      template <typename Visitor>
+      void forEachColumn(Visitor&& visit) const {
+        visitColumns(columns, visit);
+      }
+
+      template <typename Visitor>
+      void forEachColumn(Visitor&& visit) {
+        visitColumns(columns, visit);
+      }
+
+      template <typename Columns, typename Visitor>
+      static void visitColumns(Columns& columns, Visitor& visit) {
+        constexpr auto members = snapshotColumns<Relation>();
+        constexpr auto resultMembers = resultColumns<Relation>();
+        [&]<size_t... I>(std::index_sequence<I...>) {
+          (visit(std::get<I>(columns), std::get<I>(members), std::get<I>(resultMembers)), ...);
+        }(std::make_index_sequence<COLUMNS>{});
+      }
+    };
+
+    using CastTable = ColumnTable<CastRelation>;
+    using TitleTable = ColumnTable<TitleRelation>;
+
+    template <typename Relation>
+    ColumnTable<Relation> toColumnTable(const std::vector<Relation>& relation) {
+      ColumnTable<Relation> table;
+      table.resize(relation.size());
+      #pragma omp parallel for schedule(static)
+      for (size_t i = 0; i < relation.size(); ++i) {
+        table.set(i, relation[i]);
+      }
+      return table;
+    }
+
+    template <typename Relation>
+    std::vector<Relation> toRelation(const ColumnTable<Relation>& table) {
+      std::vector<Relation> relation(table.size());
+      #pragma omp parallel for schedule(static)
+      for (size_t i = 0; i < relation.size(); ++i) {
+        relation[i] = table.row(i);
+      }
+      return relation;
+    }
+
+    inline CastTable loadCastTable(const std::string& filename, const size_t numberOfTuples = SIZE_MAX) {
+      return toColumnTable(loadCastRelation(filename, numberOfTuples));
+    }
+
+    inline TitleTable loadTitleTable(const std::string& filename, const size_t numberOfTuples = SIZE_MAX) {
+      return toColumnTable(loadTitleRelation(filename, numberOfTuples));
+    }
+
+    inline ResultRelation createResultTuple(const CastTable& cast, const size_t castRow, const TitleTable& title,
+                                            const size_t titleRow) {
+      ResultRelation result;
+      title.gather(titleRow, result);
+      cast.gather(castRow, result);
+      return result;
+    }
+
 #endif //JOINUTIL_HPP
@@ -0,0 +1,179 @@
+/*
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#ifndef LENGTHHASHINDEX_HPP
+#define LENGTHHASHINDEX_HPP
+
+#include "JoinUtils.hpp"
+#include "StringKeys.hpp"
+
+#include <omp.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Prefix index that hashes every distinct folded note into an open
+ * addressing table keyed by (length, hash). A lookup computes rolling prefix
+ * hashes of the title and probes the table only at the note lengths that occur
+ * in the relation; candidates are verified by comparing the symbols.
+ */
+template <typename Cast = CastRelation>
+class LengthHashIndex {
+public:
+    void build(const std::vector<Cast>& castRelation, const KeyColumn& noteKeys, const int numThreads) {
+        const size_t count = castRelation.size();
+        std::vector<uint64_t> hashes(count);
+        #pragma omp parallel for schedule(static) num_threads(numThreads)
+        for (size_t i = 0; i < count; ++i) {
+            uint64_t hash = 0;
+            for (const char symbol : noteKeys[i]) {
+                hash = extend(hash, symbol);
+            }
+            hashes[i] = hash;
+        }
+
+        uint32_t capacity = 16;
+        while (capacity < 2 * count) capacity <<= 1;
+        mask = capacity - 1;
+        table.assign(capacity, Slot{});
+        keys.clear();
+        keyOffsets.assign(1, 0);
+
+        // Assign every note to its distinct key, then lay out the casts per key.
+        std::vector<uint32_t> keyOfNote(count);
+        std::vector<uint32_t> keySizes;
+        bool lengthSeen[KeyColumn::MAX_KEY_LENGTH + 1] = {};
+        for (size_t i = 0; i < count; ++i) {
+            const std::string_view note = noteKeys[i];
+            const uint32_t length = static_cast<uint32_t>(note.size());
+            uint32_t slot = bucketOf(hashes[i], length);
+            while (table[slot].key != EMPTY &&
+                   !(table[slot].hash == hashes[i] && table[slot].length == length && keyOf(table[slot].key) == note)) {
+                slot = (slot + 1) & mask;
+            }
+            if (table[slot].key == EMPTY) {
+                table[slot] = {hashes[i], static_cast<uint32_t>(keySizes.size()), length};
+                keys.insert(keys.end(), note.begin(), note.end());
+                keyOffsets.push_back(static_cast<uint32_t>(keys.size()));
+                keySizes.push_back(0);
+                lengthSeen[length] = true;
+            }
+            keyOfNote[i] = table[slot].key;
+            ++keySizes[table[slot].key];
+        }
+
+        castBegin.assign(keySizes.size() + 1, 0);
+        for (size_t k = 0; k < keySizes.size(); ++k) {
+            castBegin[k + 1] = castBegin[k] + keySizes[k];
+        }
+        casts.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            casts[castBegin[keyOfNote[i]] + --keySizes[keyOfNote[i]]] = &castRelation[i];
+        }
+
+        lengths.clear();
+        for (uint32_t length = 0; length <= KeyColumn::MAX_KEY_LENGTH; ++length) {
+            if (lengthSeen[length]) lengths.push_back(length);
+        }
+    }
+
+    void findPrefixMatches(std::string_view key, std::vector<const Cast*>& results) const {
+        visitPrefixMatches(key, [&](const Cast* const* first, const Cast* const* last) {
+            results.insert(results.end(), first, last);
+        });
+    }
+
+    /**
+     * @brief calls visit(first, last) for every contiguous run of cast tuples
+     * whose note is a prefix of key, without allocating; a visitor returning
+     * true stops the lookup
+     */
+    template <typename Visitor>
+    void visitPrefixMatches(std::string_view key, Visitor&& visit) const {
+        uint64_t hash = 0;
+        size_t hashed = 0;
+        for (const uint32_t noteLength : lengths) {
+            if (noteLength > key.size()) return;
+            for (; hashed < noteLength; ++hashed) {
+                hash = extend(hash, key[hashed]);
+            }
+            for (uint32_t slot = bucketOf(hash, noteLength); table[slot].key != EMPTY; slot = (slot + 1) & mask) {
+                const Slot& candidate = table[slot];
+                if (candidate.hash == hash && candidate.length == noteLength &&
+                    std::memcmp(keys.data() + keyOffsets[candidate.key], key.data(), noteLength) == 0) {
+                    if (visitRun(visit, casts.data() + castBegin[candidate.key],
+                                 casts.data() + castBegin[candidate.key + 1])) {
+                        return;
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    [[nodiscard]] size_t distinctKeys() const { return keyOffsets.size() - 1; }
+
+    [[nodiscard]] size_t distinctLengths() const { return lengths.size(); }
+
+    /**
+     * @brief bytes reserved by the table, the keys and the match lists
+     */
+    [[nodiscard]] size_t memoryBytes() const {
+        return table.capacity() * sizeof(Slot) + keys.capacity() +
+               (keyOffsets.capacity() + castBegin.capacity() + lengths.capacity()) * sizeof(uint32_t) +
+               casts.capacity() * sizeof(const Cast*);
+    }
+
+private:
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+    static constexpr uint64_t HASH_BASE = 0x100000001B3ull;
+
+    struct Slot {
+        uint64_t hash = 0;
+        uint32_t key = EMPTY;
+        uint32_t length = 0;
+    };
+
+    std::vector<Slot> table;
+    uint32_t mask = 0;
+    std::vector<char> keys;
+    std::vector<uint32_t> keyOffsets;
+    std::vector<uint32_t> castBegin;
+    std::vector<const Cast*> casts;
+    std::vector<uint32_t> lengths;
+
+    static uint64_t extend(const uint64_t hash, const char symbol) {
+        return hash * HASH_BASE + static_cast<uint8_t>(symbol) + 1;
+    }
+
+    // Mixes the length into the rolling hash (finalizer of MurmurHash3) to spread equal prefixes.
+    [[nodiscard]] uint32_t bucketOf(uint64_t hash, const uint32_t length) const {
+        hash ^= static_cast<uint64_t>(length) << 56;
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdull;
+        hash ^= hash >> 33;
+        hash *= 0xc4ceb9fe1a85ec53ull;
+        hash ^= hash >> 33;
+        return static_cast<uint32_t>(hash) & mask;
+    }
+
+    [[nodiscard]] std::string_view keyOf(const uint32_t k) const {
+        return {keys.data() + keyOffsets[k], keyOffsets[k + 1] - keyOffsets[k]};
+    }
+};
+
+#endif // LENGTHHASHINDEX_HPP
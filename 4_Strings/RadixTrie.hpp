@@ -0,0 +1,209 @@
+/*
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#ifndef RADIXTRIE_HPP
+#define RADIXTRIE_HPP
+
+#include "JoinUtils.hpp"
+#include "StringKeys.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <string_view>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+ * @brief Path-compressed (Patricia) trie over the folded alphabet. Runs of
+ * single-child nodes collapse into one edge whose label is stored in a shared
+ * label buffer and compared 16 symbols at a time. The trie is bulk loaded from
+ * the sorted notes: the children of a node are stored next to each other and
+ * the matches of a node are one contiguous run of the sorted notes.
+ */
+template <typename Cast = CastRelation>
+class RadixTrie {
+public:
+    void build(const std::vector<Cast>& castRelation, const KeyColumn& noteKeys) {
+        std::vector<uint32_t> order(castRelation.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t lhs, uint32_t rhs) { return noteKeys[lhs] < noteKeys[rhs]; });
+
+        sortedKeys.clear();
+        sortedKeys.reserve(order.size());
+        matches.clear();
+        matches.reserve(order.size());
+        for (const uint32_t i : order) {
+            sortedKeys.push_back(noteKeys[i]);
+            matches.push_back(&castRelation[i]);
+        }
+
+        nodes.assign(1, Node{});
+        childKeys.assign(1, 0);
+        labels.clear();
+        buildNode(ROOT, 0, static_cast<uint32_t>(order.size()), 0);
+        childKeys.resize(childKeys.size() + SIMD_PADDING, 0);
+        labels.resize(labels.size() + SIMD_PADDING, 0);
+        sortedKeys.clear();
+        sortedKeys.shrink_to_fit();
+    }
+
+    void findPrefixMatches(std::string_view prefix, std::vector<const Cast*>& results) const {
+        visitPrefixMatches(prefix, [&](const Cast* const* first, const Cast* const* last) {
+            results.insert(results.end(), first, last);
+        });
+    }
+
+    /**
+     * @brief calls visit(first, last) for every contiguous run of cast tuples
+     * whose note is a prefix of key, without allocating; a visitor returning
+     * true stops the lookup
+     */
+    template <typename Visitor>
+    void visitPrefixMatches(std::string_view prefix, Visitor&& visit) const {
+        // The edge labels are compared in blocks of 16 symbols, so the key is copied into a padded buffer.
+        uint8_t key[KeyColumn::MAX_KEY_LENGTH + SIMD_PADDING];
+        const size_t length = std::min(prefix.size(), KeyColumn::MAX_KEY_LENGTH);
+        std::memcpy(key, prefix.data(), length);
+
+        uint32_t node = ROOT;
+        size_t depth = 0;
+        while (true) {
+            const Node& current = nodes[node];
+            if (current.matchCount != 0 &&
+                visitRun(visit, matches.data() + current.firstMatch,
+                         matches.data() + current.firstMatch + current.matchCount)) {
+                return;
+            }
+            if (depth == length) return;
+            node = findChild(current, key[depth]);
+            if (node == NONE) return;
+            const Node& child = nodes[node];
+            if (child.labelLength > length - depth || !labelMatches(child, key + depth)) return;
+            depth += child.labelLength;
+        }
+    }
+
+    [[nodiscard]] size_t nodeCount() const { return nodes.size(); }
+
+    /**
+     * @brief bytes reserved by the nodes, labels and match lists
+     */
+    [[nodiscard]] size_t memoryBytes() const {
+        return nodes.capacity() * sizeof(Node) + childKeys.capacity() + labels.capacity() +
+               matches.capacity() * sizeof(const Cast*);
+    }
+
+private:
+    static constexpr uint32_t ROOT = 0;
+    static constexpr uint32_t NONE = UINT32_MAX;
+    static constexpr size_t SIMD_PADDING = 64;
+
+    struct Node {
+        uint32_t labelOffset = 0;  // label of the edge leading into this node
+        uint32_t firstChild = 0;   // children are stored consecutively
+        uint32_t firstMatch = 0;
+        uint32_t matchCount = 0;
+        uint8_t labelLength = 0;
+        uint8_t numChildren = 0;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<uint8_t> childKeys; // first label symbol of every node, indexed like nodes
+    std::vector<uint8_t> labels;
+    std::vector<const Cast*> matches;
+    std::vector<std::string_view> sortedKeys;
+
+    // Builds the subtree over the sorted keys [begin, end) that share their first depth symbols.
+    void buildNode(const uint32_t node, uint32_t begin, const uint32_t end, const uint32_t depth) {
+        const uint32_t firstMatch = begin;
+        while (begin < end && sortedKeys[begin].size() == depth) {
+            ++begin;
+        }
+        nodes[node].firstMatch = firstMatch;
+        nodes[node].matchCount = begin - firstMatch;
+
+        std::vector<std::pair<uint32_t, uint32_t>> groups;
+        for (uint32_t i = begin; i < end;) {
+            uint32_t j = i + 1;
+            while (j < end && sortedKeys[j][depth] == sortedKeys[i][depth]) {
+                ++j;
+            }
+            groups.emplace_back(i, j);
+            i = j;
+        }
+
+        const auto firstChild = static_cast<uint32_t>(nodes.size());
+        nodes[node].firstChild = firstChild;
+        nodes[node].numChildren = static_cast<uint8_t>(groups.size());
+        nodes.resize(nodes.size() + groups.size());
+        childKeys.resize(nodes.size());
+
+        for (size_t g = 0; g < groups.size(); ++g) {
+            const auto [groupBegin, groupEnd] = groups[g];
+            // The keys are sorted, so the common prefix of the group is the one of its first and last key.
+            const auto& first = sortedKeys[groupBegin];
+            const auto& last = sortedKeys[groupEnd - 1];
+            uint32_t common = depth + 1;
+            while (common < first.size() && common < last.size() && first[common] == last[common]) {
+                ++common;
+            }
+
+            const uint32_t child = firstChild + static_cast<uint32_t>(g);
+            nodes[child].labelOffset = static_cast<uint32_t>(labels.size());
+            nodes[child].labelLength = static_cast<uint8_t>(common - depth);
+            labels.insert(labels.end(), first.begin() + depth, first.begin() + common);
+            childKeys[child] = static_cast<uint8_t>(first[depth]);
+            buildNode(child, groupBegin, groupEnd, common);
+        }
+    }
+
+    [[nodiscard]] uint32_t findChild(const Node& node, const uint8_t symbol) const {
+#ifdef __SSE2__
+        const __m128i needle = _mm_set1_epi8(static_cast<char>(symbol));
+        for (uint32_t i = 0; i < node.numChildren; i += 16) {
+            const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(childKeys.data() + node.firstChild + i));
+            unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(needle, block));
+            if (node.numChildren - i < 16) mask &= (1u << (node.numChildren - i)) - 1;
+            if (mask) return node.firstChild + i + __builtin_ctz(mask);
+        }
+#else
+        for (uint32_t i = 0; i < node.numChildren; ++i) {
+            if (childKeys[node.firstChild + i] == symbol) return node.firstChild + i;
+        }
+#endif
+        return NONE;
+    }
+
+    [[nodiscard]] bool labelMatches(const Node& node, const uint8_t* key) const {
+        const uint8_t* label = labels.data() + node.labelOffset;
+#ifdef __SSE2__
+        for (uint32_t i = 0; i < node.labelLength; i += 16) {
+            const __m128i lhs = _mm_loadu_si128(reinterpret_cast<const __m128i*>(label + i));
+            const __m128i rhs = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key + i));
+            unsigned mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(lhs, rhs)) & 0xFFFF;
+            if (node.labelLength - i < 16) mask &= (1u << (node.labelLength - i)) - 1;
+            if (mask) return false;
+        }
+        return true;
+#else
+        return std::memcmp(label, key, node.labelLength) == 0;
+#endif
+    }
+};
+
+#endif // RADIXTRIE_HPP
@@ -0,0 +1,295 @@
+/*
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#ifndef SIMILARITYINDEX_HPP
+#define SIMILARITYINDEX_HPP
+
+#include "JoinUtils.hpp"
+#include "StringKeys.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Bit-parallel edit distance (Myers, in the block form of Hyyrö) of one
+ * pattern against many texts. Each text symbol updates one 64-bit word of the
+ * dynamic programming column per block of 64 pattern symbols.
+ */
+class EditDistancePattern {
+public:
+    static constexpr size_t MAX_BLOCKS = (sizeof(TitleRelation::title) + 63) / 64;
+
+    void prepare(const std::string_view pattern) {
+        length = pattern.size();
+        blocks = (length + 63) / 64;
+        std::fill(&peq[0][0], &peq[0][0] + TOTAL_CHILDREN * MAX_BLOCKS, 0);
+        for (size_t i = 0; i < length; ++i) {
+            peq[static_cast<uint8_t>(pattern[i])][i / 64] |= uint64_t{1} << (i % 64);
+        }
+    }
+
+    /**
+     * @brief true if the edit distance between the pattern and text is at most maxDistance
+     */
+    [[nodiscard]] bool withinDistance(const std::string_view text, const uint32_t maxDistance) const {
+        const size_t difference = length > text.size() ? length - text.size() : text.size() - length;
+        if (difference > maxDistance) return false;
+        if (blocks == 0) return text.size() <= maxDistance;
+
+        uint64_t pv[MAX_BLOCKS];
+        uint64_t mv[MAX_BLOCKS];
+        std::fill(pv, pv + blocks, ~uint64_t{0});
+        std::fill(mv, mv + blocks, 0);
+        const uint64_t lastBit = uint64_t{1} << ((length - 1) % 64);
+        size_t score = length;
+        for (size_t j = 0; j < text.size(); ++j) {
+            const uint64_t* eq = peq[static_cast<uint8_t>(text[j])];
+            // The first row of the global distance grows by one per text symbol.
+            int carry = 1;
+            for (size_t b = 0; b < blocks; ++b) {
+                carry = advanceBlock(pv[b], mv[b], eq[b], carry, b + 1 == blocks ? lastBit : uint64_t{1} << 63);
+            }
+            score += carry;
+            // Every remaining text symbol lowers the distance by at most one.
+            if (score > maxDistance + (text.size() - j - 1)) return false;
+        }
+        return score <= maxDistance;
+    }
+
+private:
+    uint64_t peq[TOTAL_CHILDREN][MAX_BLOCKS] = {};
+    size_t length = 0;
+    size_t blocks = 0;
+
+    static int advanceBlock(uint64_t& pv, uint64_t& mv, uint64_t eq, const int carryIn, const uint64_t highBit) {
+        const uint64_t xv = eq | mv;
+        if (carryIn < 0) eq |= 1;
+        const uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+        const int carryOut = (ph & highBit) ? 1 : (mh & highBit) ? -1 : 0;
+        ph <<= 1;
+        mh <<= 1;
+        if (carryIn < 0) mh |= 1; else if (carryIn > 0) ph |= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+        return carryOut;
+    }
+};
+
+/**
+ * @brief Pruning counters of a similarity join. Every pair of a probed key and
+ * an indexed key is either pruned by a filter or verified.
+ */
+struct SimilarityStats {
+    uint64_t pairs = 0;           // all pairs of probed and indexed keys
+    uint64_t candidates = 0;      // pairs left by the length and prefix filter
+    uint64_t countSurvivors = 0;  // candidates left by the count filter
+    uint64_t matches = 0;         // verified pairs within the distance
+
+    SimilarityStats& operator+=(const SimilarityStats& other) {
+        pairs += other.pairs;
+        candidates += other.candidates;
+        countSurvivors += other.countSurvivors;
+        matches += other.matches;
+        return *this;
+    }
+};
+
+/**
+ * @brief Inverted q-gram index for edit distance joins. Every key is turned
+ * into its multiset of q-grams, numbered by occurrence so that multisets
+ * become sets, and ordered by ascending frequency among the indexed keys. Two
+ * keys within distance k share at least max(|Q(s)|, |Q(t)|) - kq q-grams, so
+ * they share one of their first kq + 1 q-grams; only these prefixes are
+ * indexed. The posting lists are sorted by key length, so the length filter
+ * is a range of each list. Keys too short for any guarantee are kept apart
+ * and compared with every short probe of a matching length.
+ */
+class QGramIndex {
+public:
+    /**
+     * @brief per-thread buffers of the probe
+     */
+    struct Scratch {
+        std::vector<uint32_t> stamps;
+        uint32_t stamp = 0;
+        std::vector<uint32_t> candidates;
+        std::vector<uint32_t> ranks;
+        std::vector<uint32_t> tokens;
+        EditDistancePattern pattern;
+    };
+
+    QGramIndex(const uint32_t q, const uint32_t maxDistance) : q(q), maxDistance(maxDistance) {
+        gramCount = 1;
+        for (uint32_t i = 0; i < q; ++i) gramCount *= TOTAL_CHILDREN;
+    }
+
+    void build(const KeyColumn& indexedKeys) {
+        keys = &indexedKeys;
+        const size_t count = indexedKeys.size();
+
+        // Global order: rare q-grams first, q-grams missing from the index come before all others.
+        std::vector<uint32_t> frequency(gramCount * MAX_OCCURRENCES, 0);
+        std::vector<uint32_t> tokens;
+        for (size_t i = 0; i < count; ++i) {
+            tokenize(indexedKeys[i], tokens);
+            for (const uint32_t token : tokens) ++frequency[token];
+        }
+        std::vector<uint32_t> order(frequency.size());
+        for (uint32_t token = 0; token < order.size(); ++token) order[token] = token;
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t lhs, uint32_t rhs) { return frequency[lhs] < frequency[rhs]; });
+        rankOf.resize(order.size());
+        for (uint32_t rank = 0; rank < order.size(); ++rank) rankOf[order[rank]] = rank;
+
+        rankBegin.assign(count + 1, 0);
+        ranks.clear();
+        std::vector<uint32_t> listSizes(order.size() + 1, 0);
+        for (size_t i = 0; i < count; ++i) {
+            tokenize(indexedKeys[i], tokens);
+            for (const uint32_t token : tokens) ranks.push_back(rankOf[token]);
+            std::sort(ranks.begin() + rankBegin[i], ranks.end());
+            rankBegin[i + 1] = static_cast<uint32_t>(ranks.size());
+            for (uint32_t p = 0; p < prefixLength(tokens.size()); ++p) ++listSizes[ranks[rankBegin[i] + p] + 1];
+        }
+
+        listBegin.assign(listSizes.size(), 0);
+        for (size_t rank = 1; rank < listSizes.size(); ++rank) listBegin[rank] = listBegin[rank - 1] + listSizes[rank];
+        postings.resize(listBegin.back());
+        std::vector<uint32_t> cursor(listBegin.begin(), listBegin.end() - 1);
+        shortKeys.clear();
+        for (size_t i = 0; i < count; ++i) {
+            const uint32_t gramsOfKey = rankBegin[i + 1] - rankBegin[i];
+            for (uint32_t p = 0; p < prefixLength(gramsOfKey); ++p) {
+                postings[cursor[ranks[rankBegin[i] + p]]++] = static_cast<uint32_t>(i);
+            }
+            if (gramsOfKey <= maxDistance * q) shortKeys.push_back(static_cast<uint32_t>(i));
+        }
+        auto byLength = [&](uint32_t lhs, uint32_t rhs) {
+            return std::make_pair(indexedKeys[lhs].size(), lhs) < std::make_pair(indexedKeys[rhs].size(), rhs);
+        };
+        for (size_t rank = 0; rank + 1 < listBegin.size(); ++rank) {
+            std::sort(postings.begin() + listBegin[rank], postings.begin() + listBegin[rank + 1], byLength);
+        }
+        std::sort(shortKeys.begin(), shortKeys.end(), byLength);
+    }
+
+    [[nodiscard]] Scratch newScratch() const {
+        Scratch scratch;
+        scratch.stamps.assign(keys->size(), 0);
+        return scratch;
+    }
+
+    /**
+     * @brief calls visit(i) for every indexed key i within the edit distance of key
+     */
+    template <typename Visitor>
+    void visitSimilar(const std::string_view key, Scratch& scratch, SimilarityStats& stats, Visitor&& visit) const {
+        if (++scratch.stamp == 0) {
+            std::fill(scratch.stamps.begin(), scratch.stamps.end(), 0);
+            scratch.stamp = 1;
+        }
+        tokenize(key, scratch.tokens);
+        scratch.ranks.clear();
+        for (const uint32_t token : scratch.tokens) scratch.ranks.push_back(rankOf[token]);
+        std::sort(scratch.ranks.begin(), scratch.ranks.end());
+
+        const size_t minLength = key.size() > maxDistance ? key.size() - maxDistance : 0;
+        const size_t maxLength = key.size() + maxDistance;
+        scratch.candidates.clear();
+        auto collect = [&](const uint32_t* first, const uint32_t* last) {
+            first = std::lower_bound(first, last, minLength, [&](uint32_t i, size_t length) { return (*keys)[i].size() < length; });
+            for (; first != last && (*keys)[*first].size() <= maxLength; ++first) {
+                if (scratch.stamps[*first] == scratch.stamp) continue;
+                scratch.stamps[*first] = scratch.stamp;
+                scratch.candidates.push_back(*first);
+            }
+        };
+        for (uint32_t p = 0; p < prefixLength(scratch.ranks.size()); ++p) {
+            const uint32_t rank = scratch.ranks[p];
+            collect(postings.data() + listBegin[rank], postings.data() + listBegin[rank + 1]);
+        }
+        if (scratch.ranks.size() <= maxDistance * q) {
+            collect(shortKeys.data(), shortKeys.data() + shortKeys.size());
+        }
+
+        stats.pairs += keys->size();
+        stats.candidates += scratch.candidates.size();
+        scratch.pattern.prepare(key);
+        for (const uint32_t candidate : scratch.candidates) {
+            const uint32_t* first = ranks.data() + rankBegin[candidate];
+            const uint32_t* last = ranks.data() + rankBegin[candidate + 1];
+            const size_t required = std::max<size_t>(scratch.ranks.size(), last - first);
+            if (required > maxDistance * q && overlap(scratch.ranks, first, last) < required - maxDistance * q) continue;
+            ++stats.countSurvivors;
+            if (!scratch.pattern.withinDistance((*keys)[candidate], maxDistance)) continue;
+            ++stats.matches;
+            visit(candidate);
+        }
+    }
+
+    /**
+     * @brief bytes reserved by the rank table, the q-gram lists and the posting lists
+     */
+    [[nodiscard]] size_t memoryBytes() const {
+        return (rankOf.capacity() + rankBegin.capacity() + ranks.capacity() + listBegin.capacity() +
+                postings.capacity() + shortKeys.capacity()) * sizeof(uint32_t);
+    }
+
+private:
+    static constexpr uint32_t MAX_OCCURRENCES = sizeof(TitleRelation::title);
+
+    uint32_t q;
+    uint32_t maxDistance;
+    uint32_t gramCount;
+    const KeyColumn* keys = nullptr;
+    std::vector<uint32_t> rankOf;     // position of every token in the global order
+    std::vector<uint32_t> rankBegin;  // sorted token ranks of every indexed key
+    std::vector<uint32_t> ranks;
+    std::vector<uint32_t> listBegin;  // posting list of every rank
+    std::vector<uint32_t> postings;
+    std::vector<uint32_t> shortKeys;  // keys with at most kq q-grams
+
+    [[nodiscard]] uint32_t prefixLength(const size_t grams) const {
+        return static_cast<uint32_t>(std::min<size_t>(grams, maxDistance * q + 1));
+    }
+
+    // q-grams of the key as gram * MAX_OCCURRENCES + number of earlier occurrences of the same gram.
+    void tokenize(const std::string_view key, std::vector<uint32_t>& tokens) const {
+        tokens.clear();
+        for (size_t i = 0; i + q <= key.size(); ++i) {
+            uint32_t gram = 0;
+            for (uint32_t j = 0; j < q; ++j) gram = gram * TOTAL_CHILDREN + static_cast<uint8_t>(key[i + j]);
+            tokens.push_back(gram * MAX_OCCURRENCES);
+        }
+        std::sort(tokens.begin(), tokens.end());
+        for (size_t i = 1; i < tokens.size(); ++i) {
+            if (tokens[i] / MAX_OCCURRENCES == tokens[i - 1] / MAX_OCCURRENCES) tokens[i] = tokens[i - 1] + 1;
+        }
+    }
+
+    static size_t overlap(const std::vector<uint32_t>& lhs, const uint32_t* first, const uint32_t* last) {
+        size_t common = 0;
+        auto it = lhs.begin();
+        while (it != lhs.end() && first != last) {
+            if (*it < *first) ++it;
+            else if (*first < *it) ++first;
+            else { ++common; ++it; ++first; }
+        }
+        return common;
+    }
+};
+
+#endif // SIMILARITYINDEX_HPP
@@ -0,0 +1,158 @@
+/*
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#ifndef SORTEDPREFIXINDEX_HPP
+#define SORTEDPREFIXINDEX_HPP
+
+#include "JoinUtils.hpp"
+#include "StringKeys.hpp"
+
+#include <omp.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Pointer-free prefix index: the folded notes are sorted once into one
+ * contiguous array of distinct keys. A lookup walks the title symbol by symbol
+ * and narrows the range of keys sharing the title prefix with a binary search
+ * per symbol. Keys that end at the current depth sort first in the range and
+ * are the prefix matches.
+ */
+template <typename Cast = CastRelation>
+class SortedPrefixIndex {
+public:
+    void build(const std::vector<Cast>& castRelation, const KeyColumn& noteKeys, const int numThreads) {
+        const size_t count = castRelation.size();
+        auto noteOf = [&](const uint32_t i) { return noteKeys[i]; };
+
+        std::vector<uint32_t> order(count);
+        std::iota(order.begin(), order.end(), 0);
+        parallelSort(order, numThreads, [&](uint32_t lhs, uint32_t rhs) {
+            const int cmp = noteOf(lhs).compare(noteOf(rhs));
+            return cmp < 0 || (cmp == 0 && lhs < rhs);
+        });
+
+        keys.clear();
+        keyOffsets.assign(1, 0);
+        castBegin.clear();
+        casts.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            const std::string_view note = noteOf(order[i]);
+            if (i == 0 || note != noteOf(order[i - 1])) {
+                keys.insert(keys.end(), note.begin(), note.end());
+                keyOffsets.push_back(static_cast<uint32_t>(keys.size()));
+                castBegin.push_back(static_cast<uint32_t>(i));
+            }
+            casts[i] = &castRelation[order[i]];
+        }
+        castBegin.push_back(static_cast<uint32_t>(count));
+
+        // Range of keys per first symbol, the empty keys sort in front of all of them.
+        const uint32_t keyCount = static_cast<uint32_t>(keyOffsets.size() - 1);
+        emptyKeys = 0;
+        while (emptyKeys < keyCount && keyOf(emptyKeys).empty()) ++emptyKeys;
+        for (int symbol = 0; symbol <= TOTAL_CHILDREN; ++symbol) {
+            firstSymbolBegin[symbol] = emptyKeys;
+        }
+        for (uint32_t k = emptyKeys; k < keyCount; ++k) {
+            ++firstSymbolBegin[static_cast<uint8_t>(keyOf(k)[0]) + 1];
+        }
+        for (int symbol = 1; symbol <= TOTAL_CHILDREN; ++symbol) {
+            firstSymbolBegin[symbol] += firstSymbolBegin[symbol - 1] - emptyKeys;
+        }
+    }
+
+    void findPrefixMatches(std::string_view prefix, std::vector<const Cast*>& results) const {
+        visitPrefixMatches(prefix, [&](const Cast* const* first, const Cast* const* last) {
+            results.insert(results.end(), first, last);
+        });
+    }
+
+    /**
+     * @brief calls visit(first, last) for every contiguous run of cast tuples
+     * whose note is a prefix of key, without allocating; a visitor returning
+     * true stops the lookup
+     */
+    template <typename Visitor>
+    void visitPrefixMatches(std::string_view prefix, Visitor&& visit) const {
+        if (emitKeys(0, emptyKeys, visit) || prefix.empty()) return;
+
+        const auto first = static_cast<uint8_t>(prefix[0]);
+        uint32_t begin = firstSymbolBegin[first];
+        uint32_t end = firstSymbolBegin[first + 1];
+        for (size_t depth = 1; begin < end; ++depth) {
+            // Keys of length depth are prefixes of the title and sort before their extensions.
+            uint32_t extended = begin;
+            while (extended < end && keyLength(extended) == depth) ++extended;
+            if (emitKeys(begin, extended, visit) || depth == prefix.size()) return;
+
+            const char symbol = prefix[depth];
+            begin = lowerBound(extended, end, depth, symbol);
+            end = upperBound(begin, end, depth, symbol);
+        }
+    }
+
+    [[nodiscard]] size_t distinctKeys() const { return keyOffsets.size() - 1; }
+
+    /**
+     * @brief bytes reserved by the key array and the match lists
+     */
+    [[nodiscard]] size_t memoryBytes() const {
+        return keys.capacity() + (keyOffsets.capacity() + castBegin.capacity()) * sizeof(uint32_t) +
+               casts.capacity() * sizeof(const Cast*);
+    }
+
+private:
+    std::vector<char> keys;
+    std::vector<uint32_t> keyOffsets;
+    std::vector<uint32_t> castBegin;
+    std::vector<const Cast*> casts;
+    uint32_t emptyKeys = 0;
+    uint32_t firstSymbolBegin[TOTAL_CHILDREN + 1] = {};
+
+    [[nodiscard]] std::string_view keyOf(const uint32_t k) const {
+        return {keys.data() + keyOffsets[k], keyOffsets[k + 1] - keyOffsets[k]};
+    }
+
+    [[nodiscard]] uint32_t keyLength(const uint32_t k) const { return keyOffsets[k + 1] - keyOffsets[k]; }
+
+    [[nodiscard]] char symbolAt(const uint32_t k, const size_t depth) const { return keys[keyOffsets[k] + depth]; }
+
+    [[nodiscard]] uint32_t lowerBound(uint32_t begin, uint32_t end, const size_t depth, const char symbol) const {
+        while (begin < end) {
+            const uint32_t mid = begin + (end - begin) / 2;
+            if (symbolAt(mid, depth) < symbol) begin = mid + 1; else end = mid;
+        }
+        return begin;
+    }
+
+    [[nodiscard]] uint32_t upperBound(uint32_t begin, uint32_t end, const size_t depth, const char symbol) const {
+        while (begin < end) {
+            const uint32_t mid = begin + (end - begin) / 2;
+            if (symbolAt(mid, depth) <= symbol) begin = mid + 1; else end = mid;
+        }
+        return begin;
+    }
+
+    template <typename Visitor>
+    bool emitKeys(const uint32_t begin, const uint32_t end, Visitor& visit) const {
+        return begin != end && visitRun(visit, casts.data() + castBegin[begin], casts.data() + castBegin[end]);
+    }
+};
+
+#endif // SORTEDPREFIXINDEX_HPP
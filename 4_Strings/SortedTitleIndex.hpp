@@ -0,0 +1,121 @@
+/*
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#ifndef SORTEDTITLEINDEX_HPP
+#define SORTEDTITLEINDEX_HPP
+
+#include "StringKeys.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Index over the folded titles for the reversed build side. The titles
+ * are sorted once into one contiguous key array, so all titles that start with
+ * a note form one run: its begin is the first key not less than the note and
+ * its end the first key whose prefix of the note's length is greater. A lookup
+ * is two binary searches inside the range of the note's first symbol, and the
+ * matches of a note are reported as one run of title indices.
+ */
+class SortedTitleIndex {
+public:
+    void build(const KeyColumn& titleKeys, const int numThreads) {
+        const size_t count = titleKeys.size();
+        titles.resize(count);
+        std::iota(titles.begin(), titles.end(), 0);
+        parallelSort(titles, numThreads, [&](uint32_t lhs, uint32_t rhs) {
+            const int cmp = titleKeys[lhs].compare(titleKeys[rhs]);
+            return cmp < 0 || (cmp == 0 && lhs < rhs);
+        });
+
+        keys.clear();
+        keyOffsets.assign(1, 0);
+        for (const uint32_t title : titles) {
+            const std::string_view key = titleKeys[title];
+            keys.insert(keys.end(), key.begin(), key.end());
+            keyOffsets.push_back(static_cast<uint32_t>(keys.size()));
+        }
+
+        // Range of keys per first symbol, the empty titles sort in front of all of them.
+        uint32_t emptyKeys = 0;
+        while (emptyKeys < count && keyOf(emptyKeys).empty()) ++emptyKeys;
+        std::fill(std::begin(firstSymbolBegin), std::end(firstSymbolBegin), emptyKeys);
+        for (uint32_t k = emptyKeys; k < count; ++k) {
+            ++firstSymbolBegin[static_cast<uint8_t>(keyOf(k)[0]) + 1];
+        }
+        for (int symbol = 1; symbol <= TOTAL_CHILDREN; ++symbol) {
+            firstSymbolBegin[symbol] += firstSymbolBegin[symbol - 1] - emptyKeys;
+        }
+    }
+
+    /**
+     * @brief calls visit(first, last) with the indices of all titles that start
+     * with note, if there are any
+     */
+    template <typename Visitor>
+    void visitPrefixedTitles(const std::string_view note, Visitor&& visit) const {
+        const auto [begin, end] = prefixedRange(note);
+        if (begin == end) return;
+        visit(titles.data() + begin, titles.data() + end);
+    }
+
+    /**
+     * @brief positions in sorted order of the titles that start with note, the
+     * run covers sortedTitle(begin) up to sortedTitle(end - 1)
+     */
+    [[nodiscard]] std::pair<uint32_t, uint32_t> prefixedRange(const std::string_view note) const {
+        if (note.empty()) return {0, static_cast<uint32_t>(titles.size())};
+        const auto first = static_cast<uint8_t>(note[0]);
+        uint32_t begin = firstSymbolBegin[first];
+        uint32_t end = firstSymbolBegin[first + 1];
+        if (note.size() == 1) return {begin, end};
+
+        while (begin < end) {
+            const uint32_t mid = begin + (end - begin) / 2;
+            if (keyOf(mid).compare(note) < 0) begin = mid + 1; else end = mid;
+        }
+        uint32_t last = firstSymbolBegin[first + 1];
+        for (uint32_t low = begin; low < last;) {
+            const uint32_t mid = low + (last - low) / 2;
+            if (keyOf(mid).substr(0, note.size()) == note) low = mid + 1; else last = mid;
+        }
+        return {begin, last};
+    }
+
+    [[nodiscard]] uint32_t sortedTitle(const uint32_t position) const { return titles[position]; }
+
+    [[nodiscard]] size_t size() const { return titles.size(); }
+
+    /**
+     * @brief bytes reserved by the key array and the title order
+     */
+    [[nodiscard]] size_t memoryBytes() const {
+        return keys.capacity() + (keyOffsets.capacity() + titles.capacity()) * sizeof(uint32_t);
+    }
+
+private:
+    std::vector<uint32_t> titles; // title indices in key order
+    std::vector<char> keys;
+    std::vector<uint32_t> keyOffsets;
+    uint32_t firstSymbolBegin[TOTAL_CHILDREN + 1] = {};
+
+    [[nodiscard]] std::string_view keyOf(const uint32_t k) const {
+        return {keys.data() + keyOffsets[k], keyOffsets[k + 1] - keyOffsets[k]};
+    }
+};
+
+#endif // SORTEDTITLEINDEX_HPP
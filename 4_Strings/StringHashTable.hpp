@@ -0,0 +1,100 @@
+/*
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#ifndef STRINGHASHTABLE_HPP
+#define STRINGHASHTABLE_HPP
+
+#include "StringKeys.hpp"
+
+#include <omp.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Chained hash table over the keys of a KeyColumn for exact-match
+ * joins. Every entry carries a 32-bit fingerprint of its hash, so the keys
+ * themselves are only compared for entries whose fingerprint matches. The
+ * table is built in parallel: each thread pushes its keys onto the bucket
+ * lists with a compare-and-swap on the bucket head.
+ */
+class StringHashTable {
+public:
+    void build(const KeyColumn& keyColumn, const int numThreads) {
+        keys = &keyColumn;
+        const size_t count = keyColumn.size();
+        size_t capacity = 16;
+        while (capacity < count) capacity <<= 1;
+        mask = capacity - 1;
+        heads = std::make_unique<std::atomic<uint32_t>[]>(capacity);
+        entries.resize(count);
+
+        #pragma omp parallel num_threads(numThreads)
+        {
+            #pragma omp for schedule(static)
+            for (size_t slot = 0; slot < capacity; ++slot) {
+                heads[slot].store(NONE, std::memory_order_relaxed);
+            }
+            #pragma omp for schedule(static)
+            for (size_t i = 0; i < count; ++i) {
+                const uint64_t hash = hashKey(keyColumn[i]);
+                entries[i].tag = static_cast<uint32_t>(hash >> 32);
+                std::atomic<uint32_t>& head = heads[hash & mask];
+                uint32_t next = head.load(std::memory_order_relaxed);
+                do {
+                    entries[i].next = next;
+                } while (!head.compare_exchange_weak(next, static_cast<uint32_t>(i), std::memory_order_release,
+                                                     std::memory_order_relaxed));
+            }
+        }
+    }
+
+    /**
+     * @brief calls visit(i) for every key i of the column that equals key
+     */
+    template <typename Visitor>
+    void visitEqual(const std::string_view key, Visitor&& visit) const {
+        const uint64_t hash = hashKey(key);
+        const auto tag = static_cast<uint32_t>(hash >> 32);
+        for (uint32_t i = heads[hash & mask].load(std::memory_order_acquire); i != NONE; i = entries[i].next) {
+            if (entries[i].tag == tag && (*keys)[i] == key) {
+                visit(i);
+            }
+        }
+    }
+
+    /**
+     * @brief bytes reserved by the bucket heads and entries
+     */
+    [[nodiscard]] size_t memoryBytes() const {
+        return (mask + 1) * sizeof(std::atomic<uint32_t>) + entries.capacity() * sizeof(Entry);
+    }
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct Entry {
+        uint32_t next; // next entry of the same bucket
+        uint32_t tag;  // high half of the hash
+    };
+
+    const KeyColumn* keys = nullptr;
+    std::unique_ptr<std::atomic<uint32_t>[]> heads;
+    std::vector<Entry> entries;
+    size_t mask = 0;
+};
+
+#endif // STRINGHASHTABLE_HPP
@@ -0,0 +1,333 @@
+/*
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        https://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#ifndef STRINGKEYS_HPP
+#define STRINGKEYS_HPP
+
+#include <omp.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
+
+// Folded alphabet of the prefix join: letters are compared case-insensitively,
+// digits keep their value and every other character falls into one symbol.
+static constexpr int ALPHABET_SIZE = 36;
+static constexpr int OTHER_INDEX = ALPHABET_SIZE;
+static constexpr int TOTAL_CHILDREN = ALPHABET_SIZE + 1;
+
+static constexpr std::array<uint8_t, 256> SYMBOL_TABLE = [] {
+    std::array<uint8_t, 256> table{};
+    for (int c = 0; c < 256; ++c) {
+        if (c >= 'a' && c <= 'z') {
+            table[c] = static_cast<uint8_t>(c - 'a');
+        } else if (c >= 'A' && c <= 'Z') {
+            table[c] = static_cast<uint8_t>(c - 'A');
+        } else if (c >= '0' && c <= '9') {
+            table[c] = static_cast<uint8_t>(26 + (c - '0'));
+        } else {
+            table[c] = OTHER_INDEX;
+        }
+    }
+    return table;
+}();
+
+inline uint8_t symbolOf(const char c) {
+    return SYMBOL_TABLE[static_cast<unsigned char>(c)];
+}
+
+#ifdef __SSE2__
+// Folds 16 characters: letters become 0-25 regardless of case, digits 26-35, everything else OTHER_INDEX.
+inline __m128i foldBlock(const __m128i c) {
+    const __m128i letterOffset = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    const __m128i isLetter = _mm_cmpeq_epi8(_mm_min_epu8(letterOffset, _mm_set1_epi8(25)), letterOffset);
+    const __m128i digitOffset = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+    const __m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(digitOffset, _mm_set1_epi8(9)), digitOffset);
+    const __m128i digit = _mm_add_epi8(digitOffset, _mm_set1_epi8(26));
+    const __m128i other = _mm_set1_epi8(OTHER_INDEX);
+    const __m128i result = _mm_or_si128(_mm_and_si128(isLetter, letterOffset), _mm_andnot_si128(isLetter, other));
+    return _mm_or_si128(_mm_and_si128(isDigit, digit), _mm_andnot_si128(isDigit, result));
+}
+#endif
+
+#ifdef __AVX2__
+inline __m256i foldBlock(const __m256i c) {
+    const __m256i letterOffset = _mm256_sub_epi8(_mm256_or_si256(c, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+    const __m256i isLetter = _mm256_cmpeq_epi8(_mm256_min_epu8(letterOffset, _mm256_set1_epi8(25)), letterOffset);
+    const __m256i digitOffset = _mm256_sub_epi8(c, _mm256_set1_epi8('0'));
+    const __m256i isDigit = _mm256_cmpeq_epi8(_mm256_min_epu8(digitOffset, _mm256_set1_epi8(9)), digitOffset);
+    const __m256i digit = _mm256_add_epi8(digitOffset, _mm256_set1_epi8(26));
+    const __m256i result = _mm256_blendv_epi8(_mm256_set1_epi8(OTHER_INDEX), letterOffset, isLetter);
+    return _mm256_blendv_epi8(result, digit, isDigit);
+}
+#endif
+
+/**
+ * @brief writes the folded symbols of src[0, length) to dst, 32 or 16
+ * characters at a time where the target supports it
+ */
+inline void foldSymbols(const char* src, const size_t length, char* dst) {
+    size_t i = 0;
+#ifdef __AVX2__
+    for (; i + 32 <= length; i += 32) {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), foldBlock(block));
+    }
+#endif
+#ifdef __SSE2__
+    for (; i + 16 <= length; i += 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), foldBlock(block));
+    }
+#endif
+    for (; i < length; ++i) {
+        dst[i] = static_cast<char>(symbolOf(src[i]));
+    }
+}
+
+/**
+ * @brief Normalized keys of one string column. Every key is stored as a length
+ * byte followed by its folded symbols, all keys in one contiguous buffer. The
+ * string join engines index and probe these keys directly, so their hot loops
+ * never fold characters themselves.
+ */
+class KeyColumn {
+public:
+    // Every key may be loaded in blocks of up to 32 bytes past its end.
+    static constexpr size_t KEY_PADDING = 32;
+
+    // Longest key the length byte can hold, longer strings are cut.
+    static constexpr size_t MAX_KEY_LENGTH = 255;
+
+    KeyColumn() = default;
+
+    /**
+     * @brief folds the given char array field of every tuple in parallel
+     */
+    template <typename Relation, size_t N>
+    static KeyColumn fold(const std::vector<Relation>& relation, const char (Relation::*field)[N], const int numThreads) {
+        static_assert(N <= MAX_KEY_LENGTH, "key length must fit into the length byte");
+        return foldColumn(relation.size(), [&](const size_t i) { return strnlen(relation[i].*field, N); },
+                          [&](const size_t i) { return relation[i].*field; }, numThreads);
+    }
+
+    /**
+     * @brief folds the string_view text(tuple) of every tuple in parallel
+     */
+    template <typename Relation, typename Text>
+    static KeyColumn foldStrings(const std::vector<Relation>& relation, const Text& text, const int numThreads) {
+        return foldColumn(relation.size(),
+                          [&](const size_t i) { return std::min(text(relation[i]).size(), MAX_KEY_LENGTH); },
+                          [&](const size_t i) { return text(relation[i]).data(); }, numThreads);
+    }
+
+    std::string_view operator[](const size_t i) const {
+        const char* key = bytes.data() + offsets[i];
+        return {key + 1, static_cast<uint8_t>(key[0])};
+    }
+
+    [[nodiscard]] size_t size() const { return offsets.size(); }
+
+    [[nodiscard]] size_t memoryBytes() const { return offsets.capacity() * sizeof(uint32_t) + bytes.capacity(); }
+
+private:
+    std::vector<uint32_t> offsets; // position of the length byte of every key
+    std::vector<char> bytes;
+
+    // Two parallel passes: the key lengths give the offsets, then every key is folded into its place.
+    // The offsets are 32 bits wide, so a column holds at most 4 GiB of folded keys.
+    template <typename Length, typename Data>
+    static KeyColumn foldColumn(const size_t count, const Length& lengthOf, const Data& dataOf, const int numThreads) {
+        KeyColumn column;
+        column.offsets.resize(count + 1);
+        column.offsets[0] = 0;
+        #pragma omp parallel for schedule(static) num_threads(numThreads)
+        for (size_t i = 0; i < count; ++i) {
+            column.offsets[i + 1] = static_cast<uint32_t>(lengthOf(i) + 1);
+        }
+        size_t total = 0;
+        for (size_t i = 0; i < count; ++i) {
+            total += column.offsets[i + 1];
+            if (total > UINT32_MAX) {
+                std::cerr << "Error: Folded keys exceed " << UINT32_MAX << " bytes" << std::endl;
+                exit(-1);
+            }
+            column.offsets[i + 1] = static_cast<uint32_t>(total);
+        }
+        column.bytes.resize(total + KEY_PADDING);
+        #pragma omp parallel for schedule(static) num_threads(numThreads)
+        for (size_t i = 0; i < count; ++i) {
+            char* key = column.bytes.data() + column.offsets[i];
+            const size_t length = column.offsets[i + 1] - column.offsets[i] - 1;
+            key[0] = static_cast<char>(length);
+            foldSymbols(dataOf(i), length, key + 1);
+        }
+        column.offsets.pop_back();
+        return column;
+    }
+};
+
+#ifdef __SSE2__
+// 16 set bytes followed by 16 clear bytes, loading at BLOCK_MASK + 16 - n keeps the first n bytes of a block.
+alignas(32) inline constexpr uint8_t BLOCK_MASK[32] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+// acc * prime per 64-bit lane after folding the high bits down, SSE2 has no 64-bit multiply.
+inline __m128i scrambleLanes(__m128i acc) {
+    acc = _mm_xor_si128(acc, _mm_srli_epi64(acc, 47));
+    const __m128i prime = _mm_set1_epi32(static_cast<int>(0x9E3779B1u));
+    const __m128i low = _mm_mul_epu32(acc, prime);
+    const __m128i high = _mm_mul_epu32(_mm_srli_epi64(acc, 32), prime);
+    return _mm_add_epi64(low, _mm_slli_epi64(high, 32));
+}
+#endif
+
+/**
+ * @brief 64-bit hash of a key of a KeyColumn. The key is consumed in 16-byte
+ * blocks, the last one masked to the key length, so it relies on the padding
+ * behind the keys of the column.
+ */
+inline uint64_t hashKey(const std::string_view key) {
+    uint64_t hash;
+#ifdef __SSE2__
+    const __m128i secret = _mm_set_epi64x(0x1CAD21F72C81017CULL, 0xBE4BA423396CFEB8ULL);
+    __m128i acc = _mm_set1_epi64x(static_cast<long long>(key.size() * 0x9E3779B97F4A7C15ULL));
+    for (size_t i = 0; i < key.size(); i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key.data() + i));
+        if (key.size() - i < 16) {
+            block = _mm_and_si128(block, _mm_loadu_si128(reinterpret_cast<const __m128i*>(BLOCK_MASK + 16 - (key.size() - i))));
+        }
+        const __m128i mixed = _mm_xor_si128(block, secret);
+        const __m128i product = _mm_mul_epu32(mixed, _mm_srli_epi64(mixed, 32));
+        acc = scrambleLanes(_mm_add_epi64(_mm_add_epi64(acc, product), _mm_shuffle_epi32(block, _MM_SHUFFLE(1, 0, 3, 2))));
+    }
+    const auto low = static_cast<uint64_t>(_mm_cvtsi128_si64(acc));
+    const auto high = static_cast<uint64_t>(_mm_cvtsi128_si64(_mm_unpackhi_epi64(acc, acc)));
+    hash = low ^ (high << 31 | high >> 33);
+#else
+    hash = key.size() * 0x9E3779B97F4A7C15ULL;
+    for (const char c : key) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001B3ULL;
+    }
+#endif
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+/**
+ * @brief Groups the equal keys of a column. Every key is mapped to its group and
+ * every group remembers the first key that opened it, so work that only depends
+ * on the key can be done once per group.
+ */
+class KeyGroups {
+public:
+    static KeyGroups build(const KeyColumn& keys, const int numThreads) {
+        const size_t count = keys.size();
+        if (count >= NONE) {
+            std::cerr << "Error: Cannot group more than " << NONE - 1 << " keys" << std::endl;
+            exit(-1);
+        }
+        std::vector<uint64_t> hashes(count);
+        #pragma omp parallel for schedule(static) num_threads(numThreads)
+        for (size_t i = 0; i < count; ++i) {
+            hashes[i] = hashKey(keys[i]);
+        }
+
+        size_t capacity = 16;
+        while (capacity < 2 * count) capacity <<= 1;
+        const size_t mask = capacity - 1;
+        std::vector<uint32_t> table(capacity, NONE);
+        KeyGroups groups;
+        groups.groups.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            size_t slot = hashes[i] & mask;
+            while (table[slot] != NONE) {
+                const uint32_t first = groups.firstKey[table[slot]];
+                if (hashes[first] == hashes[i] && keys[first] == keys[i]) break;
+                slot = (slot + 1) & mask;
+            }
+            if (table[slot] == NONE) {
+                table[slot] = static_cast<uint32_t>(groups.firstKey.size());
+                groups.firstKey.push_back(static_cast<uint32_t>(i));
+            }
+            groups.groups[i] = table[slot];
+        }
+        return groups;
+    }
+
+    [[nodiscard]] uint32_t groupOf(const size_t key) const { return groups[key]; }
+
+    [[nodiscard]] uint32_t representative(const uint32_t group) const { return firstKey[group]; }
+
+    [[nodiscard]] size_t size() const { return firstKey.size(); }
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    std::vector<uint32_t> groups;   // group of every key
+    std::vector<uint32_t> firstKey; // first key of every group
+};
+
+/**
+ * @brief calls visit(first, last) for one run of prefix matches and returns
+ * whether the lookup should stop. A visitor returning void sees every run, a
+ * visitor returning bool ends the lookup by returning true.
+ */
+template <typename Visitor, typename Iterator>
+inline bool visitRun(Visitor& visit, const Iterator first, const Iterator last) {
+    if constexpr (std::is_same_v<decltype(visit(first, last)), bool>) {
+        return visit(first, last);
+    } else {
+        visit(first, last);
+        return false;
+    }
+}
+
+/**
+ * @brief sorts values with one chunk per thread and merges the chunks pairwise in parallel
+ */
+template <typename Compare>
+void parallelSort(std::vector<uint32_t>& values, const int numThreads, Compare compare) {
+    const size_t chunks = std::max(1, numThreads);
+    std::vector<size_t> bounds(chunks + 1);
+    for (size_t c = 0; c <= chunks; ++c) {
+        bounds[c] = values.size() * c / chunks;
+    }
+    #pragma omp parallel for schedule(static, 1) num_threads(numThreads)
+    for (size_t c = 0; c < chunks; ++c) {
+        std::sort(values.begin() + bounds[c], values.begin() + bounds[c + 1], compare);
+    }
+    for (size_t width = 1; width < chunks; width *= 2) {
+        #pragma omp parallel for schedule(dynamic, 1) num_threads(numThreads)
+        for (size_t c = 0; c < chunks - width; c += 2 * width) {
+            const size_t last = std::min(c + 2 * width, chunks);
+            std::inplace_merge(values.begin() + bounds[c], values.begin() + bounds[c + width],
+                               values.begin() + bounds[last], compare);
+        }
+    }
+}
+
+#endif // STRINGKEYS_HPP